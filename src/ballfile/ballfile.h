@@ -0,0 +1,90 @@
+/*
+ * Memory mappable binary format of the label balls
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BALLFILE_H
+#define BALLFILE_H
+
+#include <stdint.h>
+
+namespace ball_file {
+
+const char MAGIC[8] = { 'O', 'S', 'M', 'B', 'A', 'L', 'L', 'S' };
+const uint32_t VERSION = 1;
+// written in native byte order, a reader sees 0x04030201 on a foreign one
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+// every section starts at a multiple of this offset
+const uint64_t ALIGNMENT = 64;
+const uint32_t INDEX_NODE_SIZE = 16;
+
+/**
+ * File header. The balls are stored in importance order, row i is the ball
+ * of importance i. Columns:
+ *  - lat, lon, radius, label factor: double[count]
+ *  - level (hierarchy level id): uint64_t[count]
+ *  - osm id: int64_t[count]
+ *  - label offsets: uint64_t[count + 1], label i is the UTF-8 string
+ *    heap[offset[i], offset[i + 1])
+ *
+ * The optional index is a packed Hilbert R-tree over the ball centers.
+ * Nodes are stored level by level starting with the leaves, in Hilbert
+ * order; level l ends before node indexLevels[l], the root is the last node.
+ * Boxes are (min lat, min lon, max lat, max lon). The reference of a leaf
+ * is its row, the reference of an inner node the position of its first
+ * child, which has up to INDEX_NODE_SIZE consecutive children.
+ */
+struct Header
+{
+  char mMagic[8];
+  uint32_t mVersion;
+  uint32_t mByteOrder;
+  uint64_t mCount;
+  uint64_t mHeapSize;
+
+  uint64_t mLatOffset;
+  uint64_t mLonOffset;
+  uint64_t mLevelOffset;
+  uint64_t mRadiusOffset;
+  uint64_t mOsmIdOffset;
+  uint64_t mLabelFactorOffset;
+  uint64_t mLabelOffsetsOffset;
+  uint64_t mHeapOffset;
+
+  // 0 if the file has no index
+  uint64_t mIndexBoxesOffset;
+  uint64_t mIndexRefsOffset;
+  uint64_t mIndexLevelsOffset;
+  uint64_t mIndexNodeCount;
+  uint32_t mIndexNodeSize;
+  uint32_t mIndexLevelCount;
+
+  uint64_t mReserved[7];
+};
+
+static_assert(sizeof(Header) % ALIGNMENT == 0,
+              "the header has to keep the sections aligned");
+
+inline uint64_t
+alignOffset(uint64_t aOffset)
+{
+  return (aOffset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+} // namespace ball_file
+
+#endif // BALLFILE_H
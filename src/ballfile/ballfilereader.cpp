@@ -0,0 +1,224 @@
+/*
+ * Reader of the memory mappable label ball format
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ballfilereader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ballfilereader {
+// true if the section [aOffset, aOffset + aSize) is aligned and inside the
+// file
+bool
+isSection(uint64_t aOffset, uint64_t aSize, std::size_t aFileSize)
+{
+  return aOffset % ball_file::ALIGNMENT == 0 && aOffset <= aFileSize &&
+         aSize <= aFileSize - aOffset;
+}
+} // namespace ballfilereader
+
+ball_file::BallFileReader::BallFileReader(const std::string& aPath)
+  : mData(nullptr)
+  , mSize(0)
+  , mHeader(nullptr)
+{
+  int fd = open(aPath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open the ball file: " + aPath + "!");
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (std::size_t)info.st_size < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error("Invalid ball file: " + aPath + "!");
+  }
+  mSize = info.st_size;
+  mData = mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mData == MAP_FAILED) {
+    mData = nullptr;
+    throw std::runtime_error("Unable to map the ball file: " + aPath + "!");
+  }
+  mHeader = static_cast<const Header*>(mData);
+
+  try {
+    validate(aPath);
+  } catch (...) {
+    munmap(mData, mSize);
+    throw;
+  }
+}
+
+ball_file::BallFileReader::~BallFileReader()
+{
+  if (mData) {
+    munmap(mData, mSize);
+  }
+}
+
+void
+ball_file::BallFileReader::validate(const std::string& aPath) const
+{
+  if (std::memcmp(mHeader->mMagic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error("Not a ball file: " + aPath + "!");
+  }
+  if (mHeader->mByteOrder != BYTE_ORDER_MARK) {
+    throw std::runtime_error("The ball file " + aPath +
+                             " was written with a different byte order!");
+  }
+  if (mHeader->mVersion != VERSION) {
+    throw std::runtime_error("Unsupported version " +
+                             std::to_string(mHeader->mVersion) +
+                             " of the ball file " + aPath + "!");
+  }
+
+  uint64_t count = mHeader->mCount;
+  uint64_t columnSize = count * 8;
+  bool valid =
+    count < mSize / 8 &&
+    ballfilereader::isSection(mHeader->mLatOffset, columnSize, mSize) &&
+    ballfilereader::isSection(mHeader->mLonOffset, columnSize, mSize) &&
+    ballfilereader::isSection(mHeader->mLevelOffset, columnSize, mSize) &&
+    ballfilereader::isSection(mHeader->mRadiusOffset, columnSize, mSize) &&
+    ballfilereader::isSection(mHeader->mOsmIdOffset, columnSize, mSize) &&
+    ballfilereader::isSection(mHeader->mLabelFactorOffset, columnSize, mSize) &&
+    ballfilereader::isSection(
+      mHeader->mLabelOffsetsOffset, columnSize + 8, mSize) &&
+    ballfilereader::isSection(mHeader->mHeapOffset, mHeader->mHeapSize, mSize);
+  if (valid) {
+    // the labels have to lie inside the heap in order
+    const uint64_t* offsets = column<uint64_t>(mHeader->mLabelOffsetsOffset);
+    valid = offsets[0] == 0 && offsets[count] == mHeader->mHeapSize;
+    for (uint64_t i = 0; valid && i < count; ++i) {
+      valid = offsets[i] <= offsets[i + 1];
+    }
+  }
+  if (valid && hasIndex()) {
+    uint64_t nodes = mHeader->mIndexNodeCount;
+    valid = nodes < mSize / 8 && mHeader->mIndexNodeSize > 1 &&
+            mHeader->mIndexLevelCount > 0 &&
+            ballfilereader::isSection(
+              mHeader->mIndexBoxesOffset, nodes * 32, mSize) &&
+            ballfilereader::isSection(
+              mHeader->mIndexRefsOffset, nodes * 8, mSize) &&
+            ballfilereader::isSection(mHeader->mIndexLevelsOffset,
+                                      mHeader->mIndexLevelCount * 8ull,
+                                      mSize);
+    if (valid) {
+      // every level has at least one node
+      const uint64_t* levels = column<uint64_t>(mHeader->mIndexLevelsOffset);
+      valid = levels[0] == count &&
+              levels[mHeader->mIndexLevelCount - 1] == nodes;
+      for (uint32_t l = 1; valid && l < mHeader->mIndexLevelCount; ++l) {
+        valid = levels[l - 1] < levels[l];
+      }
+    }
+  }
+
+  if (!valid) {
+    throw std::runtime_error("Corrupt ball file: " + aPath + "!");
+  }
+}
+
+const char*
+ball_file::BallFileReader::getLabel(std::size_t aIdx, std::size_t& aSize) const
+{
+  const uint64_t* offsets = column<uint64_t>(mHeader->mLabelOffsetsOffset);
+  aSize = offsets[aIdx + 1] - offsets[aIdx];
+
+  return column<char>(mHeader->mHeapOffset) + offsets[aIdx];
+}
+
+std::string
+ball_file::BallFileReader::getLabel(std::size_t aIdx) const
+{
+  std::size_t size;
+  const char* label = getLabel(aIdx, size);
+
+  return std::string(label, size);
+}
+
+std::vector<uint64_t>
+ball_file::BallFileReader::query(double aMinLat,
+                                 double aMinLon,
+                                 double aMaxLat,
+                                 double aMaxLon) const
+{
+  std::vector<uint64_t> result;
+  const double* lat = getLat();
+  const double* lon = getLon();
+
+  if (!hasIndex()) {
+    for (uint64_t i = 0; i < size(); ++i) {
+      if (lat[i] >= aMinLat && lat[i] <= aMaxLat && lon[i] >= aMinLon &&
+          lon[i] <= aMaxLon) {
+        result.push_back(i);
+      }
+    }
+    return result;
+  }
+
+  const double* boxes = column<double>(mHeader->mIndexBoxesOffset);
+  const uint64_t* refs = column<uint64_t>(mHeader->mIndexRefsOffset);
+  const uint64_t* levels = column<uint64_t>(mHeader->mIndexLevelsOffset);
+  uint64_t nodeSize = mHeader->mIndexNodeSize;
+
+  // (first node, level) of the node groups left to visit
+  std::vector<std::pair<uint64_t, uint32_t>> stack;
+  uint32_t rootLevel = mHeader->mIndexLevelCount - 1;
+  stack.emplace_back(mHeader->mIndexNodeCount - 1, rootLevel);
+  while (!stack.empty()) {
+    uint64_t first = stack.back().first;
+    uint32_t level = stack.back().second;
+    stack.pop_back();
+
+    // the root is alone, all other groups have up to nodeSize nodes
+    uint64_t end = (level == rootLevel)
+                     ? first + 1
+                     : std::min(first + nodeSize, levels[level]);
+    for (uint64_t node = first; node < end; ++node) {
+      const double* box = boxes + 4 * node;
+      if (box[0] > aMaxLat || box[1] > aMaxLon || box[2] < aMinLat ||
+          box[3] < aMinLon) {
+        continue;
+      }
+      // a reference has to point into the level below, rows for the leaves
+      uint64_t ref = refs[node];
+      uint64_t childBegin = (level > 1) ? levels[level - 2] : 0;
+      uint64_t childEnd = (level > 0) ? levels[level - 1] : size();
+      if (ref < childBegin || ref >= childEnd) {
+        throw std::runtime_error("Corrupt ball file index!");
+      }
+      if (level == 0) {
+        result.push_back(ref);
+      } else {
+        stack.emplace_back(ref, level - 1);
+      }
+    }
+  }
+
+  return result;
+}
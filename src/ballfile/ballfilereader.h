@@ -0,0 +1,95 @@
+/*
+ * Reader of the memory mappable label ball format
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BALLFILEREADER_H
+#define BALLFILEREADER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ballfile.h"
+
+namespace ball_file {
+
+/**
+ * Maps a ball file into memory. The columns are used in place, nothing is
+ * parsed or copied on construction.
+ */
+class BallFileReader
+{
+public:
+  BallFileReader(const std::string& aPath);
+  BallFileReader(const BallFileReader&) = delete;
+  BallFileReader& operator=(const BallFileReader&) = delete;
+  ~BallFileReader();
+
+  std::size_t size() const { return mHeader->mCount; };
+
+  const double* getLat() const { return column<double>(mHeader->mLatOffset); };
+  const double* getLon() const { return column<double>(mHeader->mLonOffset); };
+  const uint64_t* getLevel() const
+  {
+    return column<uint64_t>(mHeader->mLevelOffset);
+  };
+  const double* getRadius() const
+  {
+    return column<double>(mHeader->mRadiusOffset);
+  };
+  const int64_t* getOsmId() const
+  {
+    return column<int64_t>(mHeader->mOsmIdOffset);
+  };
+  const double* getLabelFactor() const
+  {
+    return column<double>(mHeader->mLabelFactorOffset);
+  };
+
+  // the label of ball aIdx, not null terminated
+  const char* getLabel(std::size_t aIdx, std::size_t& aSize) const;
+  std::string getLabel(std::size_t aIdx) const;
+
+  bool hasIndex() const { return mHeader->mIndexBoxesOffset != 0; };
+  /**
+   * Rows of all balls with a center inside the box. Uses the index if
+   * present and scans all centers otherwise.
+   */
+  std::vector<uint64_t> query(double aMinLat,
+                              double aMinLon,
+                              double aMaxLat,
+                              double aMaxLon) const;
+
+private:
+  void* mData;
+  std::size_t mSize;
+  const Header* mHeader;
+
+  template <typename T>
+  const T* column(uint64_t aOffset) const
+  {
+    return reinterpret_cast<const T*>(static_cast<const char*>(mData) +
+                                      aOffset);
+  };
+
+  void validate(const std::string& aPath) const;
+};
+} // namespace ball_file
+
+#endif // BALLFILEREADER_H
@@ -0,0 +1,76 @@
+/*
+ * Hilbert curve index of points on a 2^32 x 2^32 grid as 64 bit keys
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HILBERT_H
+#define HILBERT_H
+
+#include <stdint.h>
+#include <utility>
+
+namespace ball_file {
+
+// bits per grid coordinate, the index of a cell has twice as many
+const uint32_t HILBERT_ORDER = 32;
+const uint32_t HILBERT_MAX_COORDINATE = 0xFFFFFFFFu;
+
+/**
+ * Position of the grid cell (aX, aY) along the Hilbert curve through the
+ * 2^32 x 2^32 grid
+ */
+inline uint64_t
+hilbertIndex(uint32_t aX, uint32_t aY)
+{
+  uint64_t index = 0;
+  for (uint32_t bit = HILBERT_ORDER; bit-- > 0;) {
+    uint32_t rx = (aX >> bit) & 1;
+    uint32_t ry = (aY >> bit) & 1;
+    index += uint64_t((3 * rx) ^ ry) << (2 * bit);
+
+    // rotate the quadrant
+    if (ry == 0) {
+      if (rx == 1) {
+        aX = HILBERT_MAX_COORDINATE - aX;
+        aY = HILBERT_MAX_COORDINATE - aY;
+      }
+      std::swap(aX, aY);
+    }
+  }
+
+  return index;
+}
+
+/**
+ * Map aValue of the range [aMin, aMax] to a grid coordinate
+ */
+inline uint32_t
+toGridCoordinate(double aValue, double aMin, double aMax)
+{
+  if (!(aMax > aMin)) {
+    return 0;
+  }
+  double cell = (aValue - aMin) / (aMax - aMin) * HILBERT_MAX_COORDINATE;
+
+  return (cell <= 0) ? 0 : (cell >= HILBERT_MAX_COORDINATE)
+                             ? HILBERT_MAX_COORDINATE
+                             : (uint32_t)cell;
+}
+} // namespace ball_file
+
+#endif // HILBERT_H
@@ -64,7 +64,13 @@ ConfigHelper::ConfigHelper(std::string input_path)
   m_font_ttf_path = root["font"]["ttf-path"].asString();
 
   m_mapping_helper = mapping_helper::MappingHelper(root["mapping"]);
+  if (root.isMember("ranking")) {
+    // registers the numeric tags of the ranking with the mapping
+    m_ranking = poi_ordering::Ranking(root["ranking"], m_mapping_helper);
+  }
   m_filter_helper = filter_helper::FilterHelper(root["filter"]);
+  m_derived_filter_helper =
+    filter_helper::FilterHelper(m_mapping_helper.deriveFilter());
 }
 
 std::string
@@ -108,5 +114,17 @@ ConfigHelper::get_filter_helper() const
 {
   return m_filter_helper;
 }
+
+const filter_helper::FilterHelper&
+ConfigHelper::get_derived_filter_helper() const
+{
+  return m_derived_filter_helper;
+}
+
+const poi_ordering::Ranking&
+ConfigHelper::get_ranking() const
+{
+  return m_ranking;
+}
 }
 // end ConfigHelper
@@ -30,6 +30,7 @@
 
 #include "filterhelper.h"
 #include "mappinghelper.h"
+#include "ranking.h"
 
 namespace config_helper {
 class ConfigHelper
@@ -47,6 +48,8 @@ public:
 
   const mapping_helper::MappingHelper& get_mapping_helper() const;
   const filter_helper::FilterHelper& get_filter_helper() const;
+  const filter_helper::FilterHelper& get_derived_filter_helper() const;
+  const poi_ordering::Ranking& get_ranking() const;
 
 private:
   std::string m_labeling_name;
@@ -60,6 +63,8 @@ private:
 
   mapping_helper::MappingHelper m_mapping_helper;
   filter_helper::FilterHelper m_filter_helper;
+  filter_helper::FilterHelper m_derived_filter_helper;
+  poi_ordering::Ranking m_ranking;
 };
 }
 
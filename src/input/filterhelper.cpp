@@ -22,16 +22,134 @@
 
 #include <assert.h>
 #include <iostream>
+#include <memory>
+#include <regex>
+#include <set>
+#include <vector>
 
 namespace filter_helper {
 namespace {
 
+/**
+ * Matches elements having the tag key with a value fully matching the regex.
+ *
+ * The regex is compiled once and shared between all thread copies. Matching
+ * is done against the block's string table: every value string is tested at
+ * most once per block, primitives only compare string ids.
+ */
+class RegexValueTagFilter : public osmpbf::AbstractTagFilter
+{
+public:
+  RegexValueTagFilter(const std::string& aKey, const std::string& aRegex)
+    : m_key(aKey)
+    , m_regex(std::make_shared<const std::regex>(aRegex,
+                                                 std::regex::ECMAScript |
+                                                   std::regex::optimize))
+    , m_pbi(nullptr)
+    , m_key_id(-1){};
+
+  RegexValueTagFilter(const RegexValueTagFilter& aOther)
+    : m_key(aOther.m_key)
+    , m_regex(aOther.m_regex)
+    , m_pbi(nullptr)
+    , m_key_id(-1){};
+
+  void assignInputAdaptor(const osmpbf::PrimitiveBlockInputAdaptor* aPbi)
+  {
+    m_pbi = aPbi;
+  }
+
+  bool rebuildCache()
+  {
+    m_key_id = -1;
+    m_value_state.clear();
+    if (m_pbi == nullptr) {
+      return false;
+    }
+
+    int size = m_pbi->stringTableSize();
+    for (int id = 0; id < size; ++id) {
+      if (m_pbi->queryStringTable(id) == m_key) {
+        m_key_id = id;
+        break;
+      }
+    }
+    if (m_key_id < 0) {
+      // no element of this block carries the key
+      return false;
+    }
+
+    m_value_state.assign((std::size_t)size, UNKNOWN);
+    return true;
+  }
+
+  osmpbf::AbstractTagFilter* copy(CopyMap& aCopies) const
+  {
+    return new RegexValueTagFilter(*this);
+  }
+
+protected:
+  bool p_matches(const osmpbf::IPrimitive& aPrimitive)
+  {
+    if (m_key_id < 0) {
+      return false;
+    }
+
+    for (int i = 0, s = aPrimitive.tagsSize(); i < s; ++i) {
+      if ((int)aPrimitive.keyId(i) != m_key_id) {
+        continue;
+      }
+
+      std::size_t valueId = aPrimitive.valueId(i);
+      if (m_value_state[valueId] == UNKNOWN) {
+        bool match = std::regex_match(
+          m_pbi->queryStringTable((int)valueId), *m_regex);
+        m_value_state[valueId] = match ? MATCH : NO_MATCH;
+      }
+      return m_value_state[valueId] == MATCH;
+    }
+
+    return false;
+  }
+
+private:
+  enum ValueState : char
+  {
+    UNKNOWN,
+    MATCH,
+    NO_MATCH
+  };
+
+  std::string m_key;
+  std::shared_ptr<const std::regex> m_regex;
+
+  const osmpbf::PrimitiveBlockInputAdaptor* m_pbi;
+  int m_key_id;
+  std::vector<ValueState> m_value_state;
+};
+
 osmpbf::AbstractTagFilter*
 create_filter(Json::Value j_filter)
 {
   auto type = j_filter["type"].asString();
   if (type == "value") {
     return new osmpbf::KeyOnlyTagFilter(j_filter["value"].asString());
+  } else if (type == "equals") {
+    return new osmpbf::KeyValueTagFilter(j_filter["key"].asString(),
+                                         j_filter["value"].asString());
+  } else if (type == "values") {
+    // the value set is resolved to string ids once per block
+    std::set<std::string> values;
+    for (auto& v : j_filter["values"]) {
+      values.insert(v.asString());
+    }
+    return new osmpbf::KeyMultiValueTagFilter(j_filter["key"].asString(),
+                                              values);
+  } else if (type == "regex") {
+    return new RegexValueTagFilter(j_filter["key"].asString(),
+                                   j_filter["regex"].asString());
+  } else if (type == "not") {
+    return new osmpbf::InversionFilter(create_filter(j_filter["operand"]));
   }
 
   // if j_filter is not a string, it is an object and has the type and operands
@@ -54,7 +172,8 @@ create_filter(Json::Value j_filter)
 }
 
 FilterHelper::FilterHelper()
-  : m_filter(){};
+  : m_filter()
+  , m_has_filter(false){};
 
 FilterHelper::FilterHelper(const Json::Value& j_filter)
   : FilterHelper()
@@ -64,18 +183,36 @@ FilterHelper::FilterHelper(const Json::Value& j_filter)
   }
 
   m_filter.reset(create_filter(j_filter));
+  m_has_filter = true;
 }
 
 FilterHelper::FilterHelper(const FilterHelper& aOther)
-  : m_filter(aOther.m_filter->copy()){};
+  : m_filter()
+  , m_has_filter(aOther.m_has_filter)
+{
+  if (m_has_filter) {
+    m_filter.reset(aOther.m_filter->copy());
+  }
+}
 
 FilterHelper&
 FilterHelper::operator=(const FilterHelper& aOther)
 {
-  m_filter.reset(aOther.m_filter->copy());
+  m_has_filter = aOther.m_has_filter;
+  if (m_has_filter) {
+    m_filter.reset(aOther.m_filter->copy());
+  } else {
+    m_filter = osmpbf::RCFilterPtr();
+  }
   return *this;
 }
 
+bool
+FilterHelper::has_filter() const
+{
+  return m_has_filter;
+}
+
 osmpbf::RCFilterPtr
 FilterHelper::get_filter() const
 {
@@ -26,6 +26,16 @@
 
 namespace filter_helper {
 
+/**
+ * Builds the osmpbf filter from the json filter description. Supported node
+ * types are:
+ *  - {"type": "value", "value": key}                  key exists
+ *  - {"type": "equals", "key": key, "value": value}   key=value
+ *  - {"type": "values", "key": key, "values": [...]}  key=any of the values
+ *  - {"type": "regex", "key": key, "regex": regex}    value fully matches
+ *  - {"type": "not", "operand": filter}
+ *  - {"type": "and" / "or", "operands": [filters]}
+ */
 class FilterHelper
 {
 public:
@@ -37,10 +47,12 @@ public:
 
   FilterHelper& operator=(const FilterHelper& aOther);
 
+  bool has_filter() const;
   osmpbf::RCFilterPtr get_filter() const;
 
 private:
   osmpbf::RCFilterPtr m_filter;
+  bool m_has_filter;
 };
 }
 
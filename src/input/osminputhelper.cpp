@@ -22,6 +22,8 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <deque>
+#include <exception>
 
 #include "osmpbf/filter.h"
 #include "osmpbf/inode.h"
@@ -29,6 +31,8 @@
 #include "osmpbf/iway.h"
 #include "osmpbf/parsehelpers.h"
 
+#include "poiordering.h"
+
 // ---- BoundingBox
 void
 osm_input::OsmInputHelper::BoundingBox::adapt(
@@ -59,6 +63,7 @@ namespace osm_parsing {
 typedef int64_t SegmentId;
 typedef int64_t NodeId;
 typedef osm_input::OsmPoi::Position Position;
+typedef mapping_helper::MappingHelper::Profile MappingProfile;
 
 std::vector<NodeId>
 concatenateSegments(NodeId aConcatNode,
@@ -197,6 +202,7 @@ struct AreaPoi
   const mapping_helper::MappingHelper::Level* mPoiLevel;
 
   std::vector<osm_input::Tag> mTags;
+  osm_input::NumericTags mNumericTags;
   std::vector<SegmentId> mOuter;
   std::vector<SegmentId> mInner;
 
@@ -204,12 +210,17 @@ struct AreaPoi
           const std::vector<osm_input::Tag>& aTags,
           const mapping_helper::MappingHelper& aMh,
           std::vector<SegmentId>& aOuterWays,
-          std::vector<SegmentId>& aInnerWays)
+          std::vector<SegmentId>& aInnerWays,
+          MappingProfile* aProfile)
     : mOsmId(aOsmId)
-    , mPoiLevel(aMh.computeLevel(aTags))
+    , mPoiLevel(nullptr)
     , mTags(aTags)
+    , mNumericTags(aMh.parseNumericTags(aTags))
     , mOuter(aOuterWays)
-    , mInner(aInnerWays){};
+    , mInner(aInnerWays)
+  {
+    mPoiLevel = aMh.computeLevel(mTags, mNumericTags, aProfile);
+  };
 
   bool getPoiInfo(std::unordered_map<SegmentId, std::vector<NodeId>>& aSegments,
                   std::unordered_map<NodeId, Position>& aNodes,
@@ -257,6 +268,7 @@ AreaPoi::getPoiInfo(
     mOsmId,
     osm_input::OsmPoi::Position(sumLat / (double)count, sumLon / (double)count),
     mTags,
+    mNumericTags,
     mPoiLevel);
 
   return true;
@@ -269,9 +281,12 @@ struct SharedAreaSet
   std::mutex lock;
 
   AreaSet* areas;
+  // merge target of the thread local mapping profiles (nullptr if disabled)
+  MappingProfile* profile;
 
-  SharedAreaSet()
-    : areas(new AreaSet()){};
+  SharedAreaSet(MappingProfile* aProfile)
+    : areas(new AreaSet())
+    , profile(aProfile){};
 };
 
 struct BlockParserAreaPoiInfo
@@ -279,6 +294,7 @@ struct BlockParserAreaPoiInfo
   SharedAreaSet* globalAreas;
   AreaSet localAreas;
   const mapping_helper::MappingHelper& mMappingHelper;
+  MappingProfile localProfile;
 
   osmpbf::RCFilterPtr m_filter;
 
@@ -287,11 +303,17 @@ struct BlockParserAreaPoiInfo
                          const filter_helper::FilterHelper& aFilterHelper)
     : globalAreas(aAreasGlobal)
     , mMappingHelper(aMappingHelper)
+    , localProfile(globalAreas->profile != nullptr
+                     ? aMappingHelper.createProfile()
+                     : MappingProfile())
     , m_filter(aFilterHelper.get_filter()){};
 
   BlockParserAreaPoiInfo(const BlockParserAreaPoiInfo& aOther)
     : globalAreas(aOther.globalAreas)
     , mMappingHelper(aOther.mMappingHelper)
+    , localProfile(globalAreas->profile != nullptr
+                     ? aOther.mMappingHelper.createProfile()
+                     : MappingProfile())
     , m_filter(aOther.m_filter->copy()){};
 
   void operator()(osmpbf::PrimitiveBlockInputAdaptor(&pbi))
@@ -303,6 +325,8 @@ struct BlockParserAreaPoiInfo
     }
 
     localAreas.clear();
+    MappingProfile* profile =
+      (globalAreas->profile != nullptr) ? &localProfile : nullptr;
 
     if (pbi.relationsSize() > 0) {
 
@@ -347,7 +371,8 @@ struct BlockParserAreaPoiInfo
             tags.emplace_back(rel.key(i), rel.value(i));
           }
 
-          localAreas.push_back(AreaPoi(id, tags, mMappingHelper, outer, inner));
+          localAreas.push_back(
+            AreaPoi(id, tags, mMappingHelper, outer, inner, profile));
         }
       }
     }
@@ -355,6 +380,10 @@ struct BlockParserAreaPoiInfo
     std::unique_lock<std::mutex> lck(globalAreas->lock);
     globalAreas->areas->insert(
       globalAreas->areas->end(), localAreas.begin(), localAreas.end());
+    if (profile != nullptr) {
+      globalAreas->profile->merge(localProfile);
+      localProfile = mMappingHelper.createProfile();
+    }
   }
 };
 
@@ -465,92 +494,201 @@ struct BlockParserNode
   }
 };
 
-struct SharedPOISet
+struct FilterStatistics
 {
-  std::mutex lock;
+  std::size_t mFilterMatches;
+  std::size_t mReferenceMatches;
+  std::size_t mClassified;
 
-  PoiSet* pois;
+  FilterStatistics()
+    : mFilterMatches(0)
+    , mReferenceMatches(0)
+    , mClassified(0){};
 
-  SharedPOISet()
-    : pois(new PoiSet()){};
+  void add(const FilterStatistics& aOther)
+  {
+    mFilterMatches += aOther.mFilterMatches;
+    mReferenceMatches += aOther.mReferenceMatches;
+    mClassified += aOther.mClassified;
+  }
 };
 
-namespace {
-enum NameLvl
+// pois collected by one block parser over all blocks it parses
+struct ThreadPOISet
 {
-  undefined = 0,
-  name_en = 50,
-  int_name = 70,
-  official_name = 80,
-  name = 100,
+  PoiSet pois;
+  // selection if the import is limited
+  poi_ordering::TopPoiHeap top;
+
+  ThreadPOISet(std::size_t aLimit, const poi_ordering::Ranking& aRanking)
+    : top(aLimit, aRanking){};
 };
 
-std::string
-get_name(std::vector<osm_input::Tag>& tags)
+struct SharedPOISet
 {
-  std::string res = "";
-  NameLvl max_name_lvl = NameLvl::undefined;
-
-  for (auto& t : tags) {
-    if (t.mKey == "name:en" && max_name_lvl < NameLvl::name_en) {
-      res = t.mValue;
-      max_name_lvl = NameLvl::name_en;
-    } else if (t.mKey == "int_name" && max_name_lvl < NameLvl::int_name) {
-      res = t.mValue;
-      max_name_lvl = NameLvl::int_name;
-    } else if (t.mKey == "official_name" &&
-               max_name_lvl < NameLvl::official_name) {
-      res = t.mValue;
-      max_name_lvl = NameLvl::name;
-    } else if (t.mKey == "name" && max_name_lvl < NameLvl::name) {
-      res = t.mValue;
-      // highest valued name - skip when found this!
-      break;
+  std::mutex lock;
+
+  PoiSet* pois;
+  // one entry per block parser, the references stay valid while parsers are
+  // added; collected by collectRuns once the parsing is done
+  std::deque<ThreadPOISet> threadPois;
+  // start offsets of the sorted per thread runs in pois, empty if the runs
+  // are not sorted
+  std::vector<std::size_t> runOffsets;
+  // sort the runs (only if the ordering merges them)
+  bool sortRuns;
+  FilterStatistics stats;
+  // merge target of the thread local mapping profiles (nullptr if disabled)
+  MappingProfile* profile;
+  // if > 0 only the limit most important pois with respect to ranking are kept
+  std::size_t limit;
+  const poi_ordering::Ranking& ranking;
+
+  SharedPOISet(MappingProfile* aProfile,
+               std::size_t aLimit,
+               const poi_ordering::Ranking& aRanking,
+               bool aSortRuns)
+    : pois(new PoiSet())
+    , sortRuns(aSortRuns)
+    , profile(aProfile)
+    , limit(aLimit)
+    , ranking(aRanking){};
+
+  ThreadPOISet* addThread()
+  {
+    std::unique_lock<std::mutex> lck(lock);
+    threadPois.emplace_back(limit, ranking);
+    return &threadPois.back();
+  };
+
+  /**
+   * Move the pois of all parsers into pois, one run per parser. The runs
+   * are sorted in parallel if sortRuns is set.
+   */
+  void collectRuns(int32_t aThreadCount)
+  {
+    if (limit > 0) {
+      for (auto& local : threadPois) {
+        local.pois = local.top.release();
+      }
+    } else if (sortRuns) {
+      // every run is sorted by one thread, by keys like poi_ordering::sortPois
+      int32_t threads = std::max(aThreadCount, 1);
+      int64_t runCount = threadPois.size();
+      std::exception_ptr error;
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+      for (int64_t i = 0; i < runCount; ++i) {
+        try {
+          poi_ordering::sortPois(threadPois[i].pois, 1);
+        } catch (...) {
+#pragma omp critical
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      }
+      if (error) {
+        std::rethrow_exception(error);
+      }
     }
-  }
 
-  return res;
-}
-} // namespace
+    std::size_t total = 0;
+    for (const auto& local : threadPois) {
+      total += local.pois.size();
+    }
+    pois->reserve(total);
+    for (auto& local : threadPois) {
+      if (sortRuns && limit == 0 && !local.pois.empty()) {
+        runOffsets.push_back(pois->size());
+      }
+      pois->insert(pois->end(),
+                   std::make_move_iterator(local.pois.begin()),
+                   std::make_move_iterator(local.pois.end()));
+      PoiSet().swap(local.pois);
+    }
+    threadPois.clear();
+  };
+};
 
 struct BlockParserPoi
 {
 
   SharedPOISet* globalPois;
-  PoiSet localPois;
+  // pois of all blocks parsed by this parser, owned by globalPois
+  ThreadPOISet* local;
+  FilterStatistics localStats;
   const mapping_helper::MappingHelper& mMappingHelper;
+  MappingProfile localProfile;
 
   osmpbf::RCFilterPtr m_filter;
+  // only evaluated to report the selectivity of m_filter
+  bool m_report_selectivity;
+  osmpbf::RCFilterPtr m_reference_filter;
 
   BlockParserPoi(SharedPOISet* aPoiGlobal,
                  const mapping_helper::MappingHelper& aMappingHelper,
-                 const filter_helper::FilterHelper& aFilterHelper)
+                 const filter_helper::FilterHelper& aFilterHelper,
+                 const filter_helper::FilterHelper* aReferenceFilter)
     : globalPois(aPoiGlobal)
+    , local(aPoiGlobal->addThread())
     , mMappingHelper(aMappingHelper)
-    , m_filter(aFilterHelper.get_filter()){};
+    , localProfile(globalPois->profile != nullptr
+                     ? aMappingHelper.createProfile()
+                     : MappingProfile())
+    , m_filter(aFilterHelper.get_filter())
+    , m_report_selectivity(aReferenceFilter != nullptr)
+    , m_reference_filter()
+  {
+    if (m_report_selectivity) {
+      m_reference_filter = aReferenceFilter->get_filter();
+    }
+  };
 
   BlockParserPoi(const BlockParserPoi& aOther)
     : globalPois(aOther.globalPois)
+    , local(aOther.globalPois->addThread())
     , mMappingHelper(aOther.mMappingHelper)
-    , m_filter(aOther.m_filter->copy()){};
+    , localProfile(globalPois->profile != nullptr
+                     ? aOther.mMappingHelper.createProfile()
+                     : MappingProfile())
+    , m_filter(aOther.m_filter->copy())
+    , m_report_selectivity(aOther.m_report_selectivity)
+    , m_reference_filter()
+  {
+    if (m_report_selectivity) {
+      m_reference_filter.reset(aOther.m_reference_filter->copy());
+    }
+  };
 
   void operator()(osmpbf::PrimitiveBlockInputAdaptor(&pbi))
   {
     m_filter->assignInputAdaptor(&pbi);
 
     bool elements_contained = m_filter->rebuildCache();
-    if (!elements_contained) {
+    bool reference_contained = false;
+    if (m_report_selectivity) {
+      m_reference_filter->assignInputAdaptor(&pbi);
+      reference_contained = m_reference_filter->rebuildCache();
+    }
+    if (!elements_contained && !reference_contained) {
       return;
     }
 
-    localPois.clear();
+    localStats = FilterStatistics();
+    MappingProfile* profile =
+      (globalPois->profile != nullptr) ? &localProfile : nullptr;
 
     if (pbi.nodesSize() > 0) {
       // const auto& tag_keys = mMappingHelper.get_tag_key_set();
 
       for (osmpbf::INodeStream node = pbi.getNodeStream(); !node.isNull();
            node.next()) {
-        if (m_filter->matches(node)) {
+        if (reference_contained && m_reference_filter->matches(node)) {
+          ++localStats.mReferenceMatches;
+        }
+
+        if (elements_contained && m_filter->matches(node)) {
+          ++localStats.mFilterMatches;
           osm_input::OsmPoi::Position pos(node.latd(), node.lond());
           int64_t id = node.id();
           std::vector<osm_input::Tag> tags;
@@ -561,25 +699,39 @@ struct BlockParserPoi
             tags.emplace_back(key, value);
           }
 
-          std::string name = get_name(tags);
-          auto level = mMappingHelper.computeLevel(tags);
+          std::string name = osm_input::OsmPoi::getImportName(tags);
+          osm_input::NumericTags numericTags =
+            mMappingHelper.parseNumericTags(tags);
+          auto level = mMappingHelper.computeLevel(tags, numericTags, profile);
           if (level->isUndefinedLvl()) {
             // skip if no level could be assigned to the poi!
             continue;
           }
+          ++localStats.mClassified;
           if (name == "" && !level->hasIcon()) {
             // skip the poi
             continue;
           }
 
-          localPois.emplace_back(id, pos, tags, level);
+          if (globalPois->limit > 0) {
+            if (local->top.admits(level, numericTags, id)) {
+              local->top.push(
+                osm_input::OsmPoi(id, pos, tags, numericTags, level));
+            }
+            continue;
+          }
+
+          local->pois.emplace_back(id, pos, tags, numericTags, level);
         }
       }
     }
 
     std::unique_lock<std::mutex> lck(globalPois->lock);
-    globalPois->pois->insert(
-      globalPois->pois->end(), localPois.begin(), localPois.end());
+    globalPois->stats.add(localStats);
+    if (profile != nullptr) {
+      globalPois->profile->merge(localProfile);
+      localProfile = mMappingHelper.createProfile();
+    }
   }
 };
 
@@ -587,13 +739,14 @@ PoiSet
 importAreaPois(osmpbf::OSMFileIn& aOsmFile,
                const mapping_helper::MappingHelper& aMappingHelper,
                const filter_helper::FilterHelper& aFilterHelper,
+               MappingProfile* aProfile,
                int32_t aThreadCount,
                int32_t aBlobCount)
 {
   bool threadPrivateProcessor = true; // set to true so that MyCounter is copied
 
   aOsmFile.reset();
-  osm_parsing::SharedAreaSet areas;
+  osm_parsing::SharedAreaSet areas(aProfile);
   osmpbf::parseFileCPPThreads(
     aOsmFile,
     osm_parsing::BlockParserAreaPoiInfo(&areas, aMappingHelper, aFilterHelper),
@@ -666,26 +819,58 @@ importAreaPois(osmpbf::OSMFileIn& aOsmFile,
   return result;
 };
 
+void
+printFilterStatistics(const FilterStatistics& aStats)
+{
+  std::printf("Derived filter admitted %lu nodes, the hand-written filter "
+              "admitted %lu nodes (%4.2f%%).\n\t%lu of the admitted nodes "
+              "were mapped to a defined level.\n",
+              aStats.mFilterMatches,
+              aStats.mReferenceMatches,
+              (aStats.mReferenceMatches > 0)
+                ? 100. * (double)aStats.mFilterMatches /
+                    (double)aStats.mReferenceMatches
+                : 0.,
+              aStats.mClassified);
+}
+
 PoiSet
 importNodePois(osmpbf::OSMFileIn& aOsmFile,
                const mapping_helper::MappingHelper& aMappingHelper,
                const filter_helper::FilterHelper& aFilterHelper,
+               const filter_helper::FilterHelper* aReferenceFilter,
+               MappingProfile* aProfile,
                int32_t aThreadCount,
-               int32_t aBlobCount)
+               int32_t aBlobCount,
+               std::size_t aLimit,
+               const poi_ordering::Ranking& aRanking,
+               bool aSortRuns,
+               std::vector<std::size_t>& aRunOffsets)
 {
-  osm_parsing::SharedPOISet pois;
+  osm_parsing::SharedPOISet pois(aProfile, aLimit, aRanking, aSortRuns);
   bool threadPrivateProcessor = true; // set to true so that MyCounter is copied
 
   osmpbf::parseFileCPPThreads(
     aOsmFile,
-    osm_parsing::BlockParserPoi(&pois, aMappingHelper, aFilterHelper),
+    osm_parsing::BlockParserPoi(
+      &pois, aMappingHelper, aFilterHelper, aReferenceFilter),
     aThreadCount,
     aBlobCount,
     threadPrivateProcessor);
+  pois.collectRuns(aThreadCount);
+
+  if (aReferenceFilter != nullptr) {
+    printFilterStatistics(pois.stats);
+  }
 
   PoiSet result;
-  result.reserve(pois.pois->size());
-  result.insert(result.begin(), pois.pois->begin(), pois.pois->end());
+  result.swap(*pois.pois);
+  aRunOffsets.swap(pois.runOffsets);
+  if (aLimit > 0) {
+    // union of the thread local selections, not sorted
+    poi_ordering::keepMostImportant(result, aLimit, aRanking, aThreadCount);
+    aRunOffsets.clear();
+  }
 
   return result;
 };
@@ -695,13 +880,54 @@ osm_input::OsmInputHelper::OsmInputHelper(
   std::string aPbfPath,
   const config_helper::ConfigHelper& config,
   int32_t aThreadCount,
-  int32_t aBlobCount)
+  int32_t aBlobCount,
+  bool aDeriveFilter)
   : mPbfPath(aPbfPath)
   , mThreadCount(aThreadCount)
   , mBlobCount(aBlobCount)
   , mMappingHelper(config.get_mapping_helper())
-  , mFilterHelper(config.get_filter_helper())
-{}
+  , mFilterHelper(aDeriveFilter ? config.get_derived_filter_helper()
+                                : config.get_filter_helper())
+  , mReferenceFilter(nullptr)
+  , mRanking(config.get_ranking())
+  , mProfileMapping(false)
+  , mLimit(0)
+  , mSortRuns(false)
+{
+  if (aDeriveFilter && config.get_filter_helper().has_filter()) {
+    mReferenceFilter = &config.get_filter_helper();
+  }
+}
+
+void
+osm_input::OsmInputHelper::enableMappingProfile()
+{
+  mProfileMapping = true;
+}
+
+const mapping_helper::MappingHelper::Profile&
+osm_input::OsmInputHelper::getMappingProfile() const
+{
+  return mMappingProfile;
+}
+
+void
+osm_input::OsmInputHelper::setLimit(std::size_t aLimit)
+{
+  mLimit = aLimit;
+}
+
+void
+osm_input::OsmInputHelper::setSortRuns(bool aSortRuns)
+{
+  mSortRuns = aSortRuns;
+}
+
+const std::vector<std::size_t>&
+osm_input::OsmInputHelper::getRunOffsets() const
+{
+  return mRunOffsets;
+}
 
 PoiSet
 osm_input::OsmInputHelper::importPoiData()
@@ -714,21 +940,54 @@ osm_input::OsmInputHelper::importPoiData()
     return PoiSet();
   }
 
-  PoiSet result;
-  PoiSet nodeResult = osm_parsing::importNodePois(
-    osmFile, mMappingHelper, mFilterHelper, mThreadCount, mBlobCount);
-  result.reserve(nodeResult.size());
-  result.insert(result.end(), nodeResult.begin(), nodeResult.end());
-
-  std::printf("Imported %lu pois from the data set.\n", nodeResult.size());
-
-  PoiSet areaResult = osm_parsing::importAreaPois(
-    osmFile, mMappingHelper, mFilterHelper, mThreadCount, mBlobCount);
+  mRunOffsets.clear();
+  mapping_helper::MappingHelper::Profile* profile =
+    mProfileMapping ? &mMappingProfile : nullptr;
+  if (mProfileMapping) {
+    mMappingProfile = mMappingHelper.createProfile();
+  }
 
-  result.reserve(areaResult.size() + nodeResult.size());
-  result.insert(result.end(), areaResult.begin(), areaResult.end());
+  PoiSet result = osm_parsing::importNodePois(osmFile,
+                                              mMappingHelper,
+                                              mFilterHelper,
+                                              mReferenceFilter,
+                                              profile,
+                                              mThreadCount,
+                                              mBlobCount,
+                                              mLimit,
+                                              mRanking,
+                                              mSortRuns,
+                                              mRunOffsets);
+  std::size_t nodeCount = result.size();
+
+  std::printf("Imported %lu pois from the data set.\n", nodeCount);
+
+  PoiSet areaResult = osm_parsing::importAreaPois(osmFile,
+                                                  mMappingHelper,
+                                                  mFilterHelper,
+                                                  profile,
+                                                  mThreadCount,
+                                                  mBlobCount);
+
+  // the area pois form the last sorted run
+  if (mSortRuns) {
+    poi_ordering::sortPois(areaResult, mThreadCount);
+    if (!areaResult.empty()) {
+      mRunOffsets.push_back(nodeCount);
+    }
+  }
+  result.reserve(areaResult.size() + nodeCount);
+  result.insert(result.end(),
+                std::make_move_iterator(areaResult.begin()),
+                std::make_move_iterator(areaResult.end()));
 
   std::printf("Imported %lu area pois from the data set.\n", areaResult.size());
 
+  if (mLimit > 0) {
+    poi_ordering::keepMostImportant(result, mLimit, mRanking, mThreadCount);
+    mRunOffsets.clear();
+    std::printf("Kept the %lu most important pois.\n", result.size());
+  }
+
   return result;
 }
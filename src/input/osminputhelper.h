@@ -28,6 +28,7 @@
 #include "filterhelper.h"
 #include "mappinghelper.h"
 #include "osmpoi.h"
+#include "ranking.h"
 
 namespace osm_input {
 
@@ -62,13 +63,28 @@ public:
   OsmInputHelper(std::string aPbfPath,
                  const config_helper::ConfigHelper& aConfig,
                  int32_t aThreadCount,
-                 int32_t aBlobCount);
+                 int32_t aBlobCount,
+                 bool aDeriveFilter = false);
   OsmInputHelper(const OsmInputHelper& other) = delete;
   OsmInputHelper& operator=(const OsmInputHelper& other) = delete;
   bool operator==(const OsmInputHelper& other) const = delete;
 
   std::vector<osm_input::OsmPoi> importPoiData();
 
+  // collect a mapping profile during the next import
+  void enableMappingProfile();
+  const mapping_helper::MappingHelper::Profile& getMappingProfile() const;
+
+  // keep only the aLimit most important pois (0: keep all)
+  void setLimit(std::size_t aLimit);
+
+  // sort the runs of the next import result, only worth it if they are merged
+  // by poi_ordering::sortPoiRuns afterwards
+  void setSortRuns(bool aSortRuns);
+
+  // start offsets of the runs the last import result consists of
+  const std::vector<std::size_t>& getRunOffsets() const;
+
 private:
   std::string mPbfPath;
   //  std::string mClassDescriptionPath;
@@ -79,6 +95,16 @@ private:
 
   const mapping_helper::MappingHelper& mMappingHelper;
   const filter_helper::FilterHelper& mFilterHelper;
+  // hand-written filter the derived filter is compared to (nullptr if unused)
+  const filter_helper::FilterHelper* mReferenceFilter;
+  const poi_ordering::Ranking& mRanking;
+
+  bool mProfileMapping;
+  mapping_helper::MappingHelper::Profile mMappingProfile;
+
+  std::size_t mLimit;
+  bool mSortRuns;
+  std::vector<std::size_t> mRunOffsets;
 };
 }
 
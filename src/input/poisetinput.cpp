@@ -0,0 +1,154 @@
+/*
+ * Import a poi set previously exported with TextOutputHelper::writePoiFile
+ *
+ * Copyright (C) 2016  Filip Krumpe <filip.krumpe@posteo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "poisetinput.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace poisetinput {
+std::vector<std::string>
+split(const std::string& aInput, char aDelim)
+{
+  std::vector<std::string> result;
+
+  std::size_t begin = 0;
+  std::size_t end = aInput.find(aDelim);
+  while (end != aInput.npos) {
+    result.push_back(aInput.substr(begin, end - begin));
+    begin = end + 1;
+    end = aInput.find(aDelim, begin);
+  }
+  result.push_back(aInput.substr(begin));
+
+  return result;
+}
+
+// inverse of the escaping done by TextOutputHelper::writePoiFile
+std::string
+unescape(const std::string& aInput)
+{
+  std::string result;
+  result.reserve(aInput.size());
+
+  for (std::size_t i = 0; i < aInput.size(); ++i) {
+    if (aInput[i] != '\\' || i + 1 == aInput.size()) {
+      result += aInput[i];
+      continue;
+    }
+
+    ++i;
+    switch (aInput[i]) {
+      case 't':
+        result += '\t';
+        break;
+      case 'n':
+        result += '\n';
+        break;
+      case 'r':
+        result += '\r';
+        break;
+      default:
+        result += aInput[i];
+        break;
+    }
+  }
+
+  return result;
+}
+}
+
+poiset_input::PoiSetInput::PoiSetInput(std::string aInputPath)
+{
+  std::ifstream file(aInputPath);
+
+  if (!file.is_open()) {
+    std::printf("File %s could not be opened!\n", aInputPath.c_str());
+    return;
+  }
+
+  std::string line;
+  if (std::getline(file, line)) {
+    std::size_t count = std::strtoull(line.c_str(), nullptr, 10);
+    mOsmIds.reserve(count);
+    mPositions.reserve(count);
+    mTags.reserve(count);
+  }
+
+  for (std::string line; std::getline(file, line);) {
+    auto splitted = poisetinput::split(line, '\t');
+    if (splitted.size() < 4) {
+      std::printf("Skipping malformed poi line: %s\n", line.c_str());
+      continue;
+    }
+
+    std::size_t tagCount = std::strtoull(splitted[3].c_str(), nullptr, 10);
+    if (splitted.size() != 4 + 2 * tagCount) {
+      std::printf("Skipping malformed poi line: %s\n", line.c_str());
+      continue;
+    }
+
+    std::vector<osm_input::Tag> tags;
+    tags.reserve(tagCount);
+    for (std::size_t i = 0; i < tagCount; ++i) {
+      tags.emplace_back(poisetinput::unescape(splitted[4 + 2 * i]),
+                        poisetinput::unescape(splitted[5 + 2 * i]));
+    }
+
+    mOsmIds.push_back(std::strtoll(splitted[0].c_str(), nullptr, 10));
+    mPositions.emplace_back(std::strtod(splitted[1].c_str(), nullptr),
+                            std::strtod(splitted[2].c_str(), nullptr));
+    mTags.push_back(std::move(tags));
+  }
+}
+
+std::vector<osm_input::OsmPoi>
+poiset_input::PoiSetInput::classifyPois(
+  const mapping_helper::MappingHelper& aMapping,
+  int32_t aThreadCount,
+  mapping_helper::MappingHelper::Profile* aProfile) const
+{
+  std::vector<osm_input::NumericTags> numericTags;
+  std::vector<uint64_t> levelIds = aMapping.computeLevelIds(
+    mTags.data(), mTags.size(), aThreadCount, aProfile, &numericTags);
+
+  std::vector<osm_input::OsmPoi> result;
+  result.reserve(mTags.size());
+  for (std::size_t i = 0; i < mTags.size(); ++i) {
+    const auto* level = aMapping.getLevel(levelIds[i]);
+    if (level->isUndefinedLvl()) {
+      continue;
+    }
+    // the same pois as in a fresh import are dropped
+    if (!level->hasIcon() &&
+        osm_input::OsmPoi::getImportName(mTags[i]).empty()) {
+      continue;
+    }
+
+    result.emplace_back(mOsmIds[i],
+                        mPositions[i],
+                        mTags[i],
+                        std::move(numericTags[i]),
+                        level);
+  }
+
+  return result;
+}
@@ -0,0 +1,60 @@
+/*
+ * Import a poi set previously exported with TextOutputHelper::writePoiFile
+ *
+ * Copyright (C) 2016  Filip Krumpe <filip.krumpe@posteo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef POISETINPUT_H
+#define POISETINPUT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "mappinghelper.h"
+#include "osmpoi.h"
+#include "tag.h"
+
+namespace poiset_input {
+
+class PoiSetInput
+{
+public:
+  PoiSetInput(std::string aInputPath);
+  PoiSetInput(const PoiSetInput& other) = delete;
+  PoiSetInput& operator=(const PoiSetInput& other) = delete;
+  bool operator==(const PoiSetInput& other) const = delete;
+
+  std::size_t size() const { return mOsmIds.size(); };
+
+  /**
+   * Classify the stored tag sets with the given mapping using aThreadCount
+   * threads. Pois mapped to the undefined level are dropped.
+   */
+  std::vector<osm_input::OsmPoi> classifyPois(
+    const mapping_helper::MappingHelper& aMapping,
+    int32_t aThreadCount,
+    mapping_helper::MappingHelper::Profile* aProfile = nullptr) const;
+
+private:
+  std::vector<int64_t> mOsmIds;
+  std::vector<osm_input::OsmPoi::Position> mPositions;
+  std::vector<std::vector<osm_input::Tag>> mTags;
+};
+}
+
+#endif // POISETINPUT_H
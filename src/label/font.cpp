@@ -25,14 +25,21 @@
 #include <algorithm>
 #include <assert.h>
 #include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <math.h>
 #include <stdexcept>
 
+#include <omp.h>
+
 #include "font.h"
+#include "fontmetrics.h"
 #include "utf8helper.h"
 
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
 namespace fonts {
 int32_t FONT_DPI = 96;
 
@@ -95,106 +102,377 @@ struct AlignedBMP_A8
   unsigned char* getBytes() { return mData.data(); }
 };
 
-// glyph struct
-void
-Font::Glyph::updateKerning(std::u32string aAlphabet, fonts::Font* aFont)
+// Advances are only read, so the glyphs are not rendered. Hinting is kept:
+// FT_LOAD_NO_HINTING changes the rounded advances at the 1pt size used here.
+const FT_Int32 METRICS_LOAD_FLAGS = FT_LOAD_DEFAULT;
+
+int32_t
+loadAdvance(FT_Face aFace, FT_UInt aGlyphIndex)
 {
-  FT_Face face = *aFont->getFontFace();
-  int32_t idx = FT_Get_Char_Index(face, mLetter);
+  auto error = FT_Load_Glyph(aFace, aGlyphIndex, METRICS_LOAD_FLAGS);
+  if (error) {
+    throw std::runtime_error("Unable to load glyph index: " +
+                             std::to_string(aGlyphIndex) + "! Error was: " +
+                             std::to_string(error));
+  }
 
-  for (char32_t c : aAlphabet) {
-    if (mKerning.find(c) != mKerning.end()) {
-      // kerning was already inserted ...
-      continue;
-    }
+  return (int32_t)std::ceil(fromFP26_6(aFace->glyph->metrics.horiAdvance));
+}
 
-    int32_t c_idx = FT_Get_Char_Index(face, c);
-    FT_Vector kerning;
-    auto error = FT_Get_Kerning(face, c_idx, idx, FT_KERNING_DEFAULT, &kerning);
-    if (error) {
-      throw std::runtime_error(
-        "Unable to get glyph kerning: " + std::to_string(c) + " - " +
-        std::to_string(mLetter) + "! Error was: " + std::to_string(error));
+uint32_t
+readU16(const FT_Byte* aData)
+{
+  return ((uint32_t)aData[0] << 8) | (uint32_t)aData[1];
+}
+
+bool
+readKerningPairs(FT_Face aFace,
+                 const std::vector<uint32_t>& aIndices,
+                 std::vector<uint64_t>& aPairs)
+{
+  FT_ULong length = 0;
+  if (!FT_IS_SFNT(aFace) ||
+      FT_Load_Sfnt_Table(aFace, TTAG_kern, 0, nullptr, &length) != 0 ||
+      length < 4) {
+    return false;
+  }
+  std::vector<FT_Byte> table(length);
+  if (FT_Load_Sfnt_Table(aFace, TTAG_kern, 0, table.data(), &length) != 0 ||
+      readU16(table.data()) != 0) {
+    return false;
+  }
+
+  const FT_Byte* end = table.data() + length;
+  const FT_Byte* subtable = table.data() + 4;
+  uint32_t subtableCount = readU16(table.data() + 2);
+  for (uint32_t t = 0; t < subtableCount && subtable + 14 <= end; ++t) {
+    // header: version, length, coverage; the format is the high coverage byte
+    const FT_Byte* next = std::min(subtable + readU16(subtable + 2), end);
+    uint32_t coverage = readU16(subtable + 4);
+    if ((coverage & 3) == 1 && (coverage >> 8) == 0) {
+      std::size_t pairCount =
+        std::min<std::size_t>(readU16(subtable + 6), (next - subtable - 14) / 6);
+      const FT_Byte* pair = subtable + 14;
+      for (std::size_t i = 0; i < pairCount; ++i, pair += 6) {
+        uint32_t prev = readU16(pair);
+        uint32_t nextIndex = readU16(pair + 2);
+        if (std::binary_search(aIndices.begin(), aIndices.end(), prev) &&
+            std::binary_search(aIndices.begin(), aIndices.end(), nextIndex)) {
+          aPairs.push_back(((uint64_t)prev << 32) | (uint64_t)nextIndex);
+        }
+      }
+    }
+    if (next <= subtable + 6) {
+      break;
     }
-    mKerning.emplace(
-      c, Kerning(c, mLetter, (int64_t)std::ceil(fromFP26_6(kerning.x))));
+    subtable = next;
   }
+
+  std::sort(aPairs.begin(), aPairs.end());
+  aPairs.erase(std::unique(aPairs.begin(), aPairs.end()), aPairs.end());
+  return true;
 }
 
-int64_t
-Font::Glyph::getKerning(char32_t c)
+const std::size_t SUPPLEMENTARY_INITIAL_SIZE = 64;
+const std::size_t KERNING_INITIAL_SIZE = 1024;
+
+std::size_t
+hashChar(char32_t aChar)
 {
-  auto it = mKerning.find(c);
-  assert(it != mKerning.end());
+  return (std::size_t)aChar * 0x9E3779B1u;
+}
 
-  return it->second.mKerning;
+uint64_t
+toKerningKey(char32_t aPrev, char32_t aNext)
+{
+  return ((uint64_t)aPrev << 32) | (uint64_t)aNext;
+}
+
+std::size_t
+hashKerningKey(uint64_t aKey)
+{
+  uint64_t h = aKey * 0x9E3779B97F4A7C15ull;
+  return (std::size_t)(h ^ (h >> 32));
 }
 } // namespace fonts
 
-// public class functions
-fonts::Font::Font(const std::string& fontPath)
+const int32_t fonts::Font::UNKNOWN_ADVANCE;
+const char32_t fonts::Font::BMP_SIZE;
+const uint64_t fonts::Font::EMPTY_KERNING_KEY;
+
+// private class functions
+const fonts::Font::GlyphMetrics&
+fonts::Font::findSupplementaryGlyph(char32_t aChar) const
 {
-  initFontFace(mFTLib, mFace, fontPath);
-  mName = mFace->family_name;
-  mStyle = mFace->style_name;
+  static const GlyphMetrics UNKNOWN;
 
-  std::cout << "Started font config import: " << mName << " - " << mName
-            << std::endl;
+  std::size_t mask = mSupplementaryKeys.size() - 1;
+  for (std::size_t i = fonts::hashChar(aChar) & mask;; i = (i + 1) & mask) {
+    if (mSupplementaryKeys[i] == aChar) {
+      return mSupplementaryGlyphs[i];
+    }
+    if (mSupplementaryKeys[i] == 0) {
+      return UNKNOWN;
+    }
+  }
+}
+
+fonts::Font::GlyphMetrics&
+fonts::Font::insertSupplementaryGlyph(char32_t aChar)
+{
+  // keep the load factor below 1/2
+  if (2 * (mSupplementaryCount + 1) > mSupplementaryKeys.size()) {
+    std::vector<char32_t> keys(2 * mSupplementaryKeys.size(), 0);
+    std::vector<GlyphMetrics> glyphs(keys.size());
+    keys.swap(mSupplementaryKeys);
+    glyphs.swap(mSupplementaryGlyphs);
+    mSupplementaryCount = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] != 0) {
+        insertSupplementaryGlyph(keys[i]) = glyphs[i];
+      }
+    }
+  }
+
+  std::size_t mask = mSupplementaryKeys.size() - 1;
+  std::size_t i = fonts::hashChar(aChar) & mask;
+  while (mSupplementaryKeys[i] != 0 && mSupplementaryKeys[i] != aChar) {
+    i = (i + 1) & mask;
+  }
+  if (mSupplementaryKeys[i] == 0) {
+    mSupplementaryKeys[i] = aChar;
+    ++mSupplementaryCount;
+  }
+
+  return mSupplementaryGlyphs[i];
 }
 
 int32_t
-fonts::Font::computeTextLength(const std::u32string& aStr)
+fonts::Font::computeKerning(uint32_t aPrevIndex, uint32_t aNextIndex) const
 {
-  if (aStr.size() == 0) {
+  if (mMetrics) {
+    return mMetrics->getKerning(aPrevIndex, aNextIndex);
+  }
+
+  FT_Vector kerning;
+  auto error =
+    FT_Get_Kerning(mFace, aPrevIndex, aNextIndex, FT_KERNING_DEFAULT, &kerning);
+  if (error) {
+    throw std::runtime_error(
+      "Unable to get glyph kerning: " + std::to_string(aPrevIndex) + " - " +
+      std::to_string(aNextIndex) + "! Error was: " + std::to_string(error));
+  }
+
+  return (int32_t)std::ceil(fromFP26_6(kerning.x));
+}
+
+void
+fonts::Font::growKerningTable()
+{
+  std::vector<uint64_t> keys(2 * mKerningKeys.size(), EMPTY_KERNING_KEY);
+  std::vector<int32_t> values(keys.size(), 0);
+  std::size_t mask = keys.size() - 1;
+
+  for (std::size_t i = 0; i < mKerningKeys.size(); ++i) {
+    if (mKerningKeys[i] == EMPTY_KERNING_KEY) {
+      continue;
+    }
+    std::size_t j = fonts::hashKerningKey(mKerningKeys[i]) & mask;
+    while (keys[j] != EMPTY_KERNING_KEY) {
+      j = (j + 1) & mask;
+    }
+    keys[j] = mKerningKeys[i];
+    values[j] = mKerningValues[i];
+  }
+
+  mKerningKeys.swap(keys);
+  mKerningValues.swap(values);
+}
+
+int32_t
+fonts::Font::getKerning(char32_t aPrev,
+                        uint32_t aPrevIndex,
+                        char32_t aNext,
+                        uint32_t aNextIndex)
+{
+  if (!mHasKerning) {
     return 0;
   }
 
-  bool updateRequired = false;
-  for (char32_t c : aStr) {
-    if (mAlphabet.find(c) == mAlphabet.end()) {
-      updateRequired = true;
-      break;
+  uint64_t key = fonts::toKerningKey(aPrev, aNext);
+  std::size_t mask = mKerningKeys.size() - 1;
+  std::size_t i = fonts::hashKerningKey(key) & mask;
+  while (mKerningKeys[i] != EMPTY_KERNING_KEY) {
+    if (mKerningKeys[i] == key) {
+      return mKerningValues[i];
     }
+    i = (i + 1) & mask;
   }
 
-  if (updateRequired) {
-    for (char32_t c : aStr) {
-      if (mAlphabet.find(c) != mAlphabet.end()) {
-        continue;
-      }
+  int32_t kerning = computeKerning(aPrevIndex, aNextIndex);
+  // keep the load factor below 1/2
+  if (2 * (mKerningCount + 1) > mKerningKeys.size()) {
+    growKerningTable();
+    mask = mKerningKeys.size() - 1;
+    i = fonts::hashKerningKey(key) & mask;
+    while (mKerningKeys[i] != EMPTY_KERNING_KEY) {
+      i = (i + 1) & mask;
+    }
+  }
+  mKerningKeys[i] = key;
+  mKerningValues[i] = kerning;
+  ++mKerningCount;
 
-      mCurrentAlphabet += c;
+  return kerning;
+}
 
-      auto error = FT_Load_Char(mFace, c, FT_LOAD_RENDER);
-      if (error) {
-        throw std::runtime_error("Unable to load glyph: " + std::to_string(c) +
-                                 "! Error was: " + std::to_string(error));
-      }
-      int64_t adv =
-        (int64_t)std::ceil(fromFP26_6(mFace->glyph->metrics.horiAdvance));
+void
+fonts::Font::openFace() const
+{
+  if (!mFaceOpen) {
+    initFontFace(mFTLib, mFace, mFontPath);
+    mFaceOpen = true;
+  }
+}
 
-      mAlphabet.emplace(c, Glyph(c, adv));
+const fonts::Font::GlyphMetrics&
+fonts::Font::loadGlyph(char32_t aChar)
+{
+  GlyphMetrics metrics;
+  if (mMetrics) {
+    // characters missing in the font are drawn with the notdef glyph 0
+    if (!mMetrics->findGlyph(aChar, metrics.mAdvance, metrics.mIndex)) {
+      metrics = GlyphMetrics(mMetrics->getNotdefAdvance(), 0);
     }
+  } else {
+    FT_UInt index = FT_Get_Char_Index(mFace, aChar);
+    metrics = GlyphMetrics(fonts::loadAdvance(mFace, index), index);
+  }
 
-    for (auto& c : mAlphabet) {
-      c.second.updateKerning(mCurrentAlphabet, this);
+  mCurrentAlphabet += aChar;
+
+  if (aChar < BMP_SIZE) {
+    return mBmpGlyphs[aChar] = metrics;
+  }
+  return insertSupplementaryGlyph(aChar) = metrics;
+}
+
+// public class functions
+fonts::Font::Font(const std::string& aFontPath,
+                  std::shared_ptr<const FontMetrics> aMetrics)
+  : mFontPath(aFontPath)
+  , mMetrics(aMetrics)
+  , mFaceOpen(false)
+  , mBmpGlyphs(BMP_SIZE)
+  , mSupplementaryKeys(fonts::SUPPLEMENTARY_INITIAL_SIZE, 0)
+  , mSupplementaryGlyphs(fonts::SUPPLEMENTARY_INITIAL_SIZE)
+  , mSupplementaryCount(0)
+  , mKerningKeys(fonts::KERNING_INITIAL_SIZE, EMPTY_KERNING_KEY)
+  , mKerningValues(fonts::KERNING_INITIAL_SIZE, 0)
+  , mKerningCount(0)
+{
+  // fonts without a kerning table always report a kerning of 0
+  if (mMetrics) {
+    mHasKerning = mMetrics->hasKerning();
+    mName = mMetrics->getName();
+    mStyle = mMetrics->getStyle();
+  } else {
+    openFace();
+    mHasKerning = FT_HAS_KERNING(mFace);
+    mName = mFace->family_name;
+    mStyle = mFace->style_name;
+  }
+
+  std::cout << "Started font config import: " << mName << " - " << mName
+            << std::endl;
+}
+
+fonts::Font::~Font()
+{
+  if (mFaceOpen) {
+    FT_Done_Face(mFace);
+    FT_Done_FreeType(mFTLib);
+  }
+}
+
+void
+fonts::Font::addToAlphabet(const char32_t* aBegin, const char32_t* aEnd)
+{
+  for (const char32_t* it = aBegin; it != aEnd; ++it) {
+    if (!findGlyph(*it).isLoaded()) {
+      loadGlyph(*it);
     }
   }
+}
+
+int32_t
+fonts::Font::computeTextLength(const std::u32string& aStr)
+{
+  return computeTextLength(aStr.data(), aStr.data() + aStr.size());
+}
+
+int32_t
+fonts::Font::computeTextLength(const char32_t* aBegin, const char32_t* aEnd)
+{
+  if (aBegin == aEnd) {
+    return 0;
+  }
 
-  auto glyph = mAlphabet.at(aStr[0]);
-  int64_t length = glyph.mAdvance;
+  const GlyphMetrics* glyph = &findGlyph(*aBegin);
+  if (!glyph->isLoaded()) {
+    glyph = &loadGlyph(*aBegin);
+  }
+  int64_t length = glyph->mAdvance;
+  uint32_t prevIndex = glyph->mIndex;
 
-  for (size_t idx = 1, size = aStr.size(); idx < size; ++idx) {
-    glyph = mAlphabet.at(aStr[idx]);
-    length += glyph.mAdvance + glyph.getKerning(aStr[idx - 1]);
+  for (const char32_t* it = aBegin + 1; it != aEnd; ++it) {
+    glyph = &findGlyph(*it);
+    if (!glyph->isLoaded()) {
+      glyph = &loadGlyph(*it);
+    }
+    length +=
+      glyph->mAdvance + getKerning(it[-1], prevIndex, *it, glyph->mIndex);
+    prevIndex = glyph->mIndex;
   }
 
-  return length;
+  return (int32_t)length;
+}
+
+void
+fonts::Font::computePrefixLengths(const char32_t* aBegin,
+                                  const char32_t* aEnd,
+                                  std::vector<int32_t>& aPrefix,
+                                  std::vector<int32_t>& aKerning)
+{
+  std::size_t size = aEnd - aBegin;
+  aPrefix.resize(size + 1);
+  aKerning.resize(size + 1);
+  aPrefix[0] = 0;
+  aKerning[0] = 0;
+
+  int64_t length = 0;
+  uint32_t prevIndex = 0;
+  for (std::size_t k = 0; k < size; ++k) {
+    const GlyphMetrics* glyph = &findGlyph(aBegin[k]);
+    if (!glyph->isLoaded()) {
+      glyph = &loadGlyph(aBegin[k]);
+    }
+    int32_t kerning =
+      (k > 0) ? getKerning(aBegin[k - 1], prevIndex, aBegin[k], glyph->mIndex)
+              : 0;
+    length += glyph->mAdvance + kerning;
+    aKerning[k] = kerning;
+    aPrefix[k + 1] = (int32_t)length;
+    prevIndex = glyph->mIndex;
+  }
+  aKerning[size] = 0;
 }
 
 void
 fonts::Font::createFontAtlas(const std::string& aName) const
 {
+  openFace();
+
   std::u32string alphabet = mCurrentAlphabet;
   std::sort(alphabet.begin(), alphabet.end());
   // get overall glyph information
@@ -360,8 +638,117 @@ fonts::Font::createFontAtlas(const std::string& aName) const
   output.close();
 }
 
+void
+fonts::Font::writeMetrics(const std::string& aFontPath,
+                          uint64_t aFontHash,
+                          const std::string& aMetricsPath,
+                          int32_t aThreadCount)
+{
+  Font font(aFontPath);
+  FT_Face face = font.mFace;
+
+  FontMetrics::Content content;
+  content.mFontHash = aFontHash;
+  content.mName = font.mName;
+  content.mStyle = font.mStyle;
+  content.mXPpem = font.getMeanLetterWidth();
+  content.mNotdefAdvance = fonts::loadAdvance(face, 0);
+  content.mHasKerning = font.mHasKerning;
+
+  // glyph 0 is used for all characters missing in the cmap
+  std::vector<uint32_t> indices(1, 0);
+  FT_UInt index;
+  FT_ULong c = FT_Get_First_Char(face, &index);
+  while (index != 0) {
+    if (c > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("Character code out of range in font: " +
+                               aFontPath + "!");
+    }
+    FontMetrics::GlyphRecord glyph;
+    glyph.mChar = (uint32_t)c;
+    glyph.mAdvance = fonts::loadAdvance(face, index);
+    glyph.mIndex = index;
+    content.mGlyphs.push_back(glyph);
+    indices.push_back(index);
+
+    c = FT_Get_Next_Char(face, c, &index);
+  }
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+  if (content.mHasKerning) {
+    // FT_Get_Kerning has no pair enumeration: query the pairs listed in the
+    // kern table, or all pairs if the font has none (e.g. Type 1 with AFM)
+    std::vector<uint64_t> pairs;
+    bool listed = fonts::readKerningPairs(face, indices, pairs);
+    int64_t rows = listed ? (int64_t)pairs.size() : (int64_t)indices.size();
+    if (!listed) {
+      std::cout << "The font has no kern table, querying the kerning of all "
+                << indices.size() * indices.size() << " glyph pairs."
+                << std::endl;
+    }
+
+    // one face per thread
+    int32_t threads = std::max(aThreadCount, 1);
+    std::vector<std::unique_ptr<Font>> fonts;
+    for (int32_t i = 0; i < threads; ++i) {
+      fonts.emplace_back(new Font(aFontPath));
+    }
+    std::vector<std::vector<FontMetrics::KerningRecord>> kerning(threads);
+    auto addKerning = [](const Font& aFont,
+                         uint64_t aKey,
+                         std::vector<FontMetrics::KerningRecord>& aResult) {
+      int32_t value =
+        aFont.computeKerning((uint32_t)(aKey >> 32), (uint32_t)aKey);
+      if (value != 0) {
+        FontMetrics::KerningRecord record;
+        record.mKey = aKey;
+        record.mKerning = value;
+        record.mPadding = 0;
+        aResult.push_back(record);
+      }
+    };
+    std::exception_ptr error;
+#pragma omp parallel for schedule(dynamic, 16) num_threads(threads)
+    for (int64_t i = 0; i < rows; ++i) {
+      const Font& local = *fonts[omp_get_thread_num()];
+      std::vector<FontMetrics::KerningRecord>& result =
+        kerning[omp_get_thread_num()];
+      try {
+        if (listed) {
+          addKerning(local, pairs[i], result);
+        } else {
+          for (uint32_t next : indices) {
+            addKerning(
+              local, ((uint64_t)indices[i] << 32) | (uint64_t)next, result);
+          }
+        }
+      } catch (...) {
+#pragma omp critical
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+
+    for (const auto& records : kerning) {
+      content.mKerning.insert(
+        content.mKerning.end(), records.begin(), records.end());
+    }
+  }
+
+  FontMetrics::write(content, aMetricsPath);
+}
+
 int32_t
 fonts::Font::getMeanLetterWidth() const
 {
+  if (mMetrics) {
+    return mMetrics->getXPpem();
+  }
+
   return (int32_t)std::ceil(mFace->size->metrics.x_ppem);
 }
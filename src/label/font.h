@@ -22,7 +22,9 @@
 #ifndef FONT_H
 #define FONT_H
 
-#include <map>
+#include <limits>
+#include <memory>
+#include <stdint.h>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -36,60 +38,147 @@
 
 namespace fonts {
 
+class FontMetrics;
+
 class Font
 {
 private:
-  struct Kerning
-  {
-    char32_t mPredecessor;
-    char32_t mSuccessor;
-
-    int64_t mKerning;
-
-    Kerning(char32_t aPred, char32_t aSucc, int64_t aKern)
-      : mPredecessor(aPred)
-      , mSuccessor(aSucc)
-      , mKerning(aKern){};
-  };
-
-  struct Glyph
+  // metrics of a loaded glyph
+  struct GlyphMetrics
   {
-    char32_t mLetter;
-    int64_t mAdvance;
-    std::unordered_map<char32_t, Kerning> mKerning;
+    int32_t mAdvance;
+    uint32_t mIndex;
 
-    Glyph(char32_t aLetter, int64_t aAdv)
-      : mLetter(aLetter)
-      , mAdvance(aAdv){};
+    GlyphMetrics()
+      : mAdvance(UNKNOWN_ADVANCE)
+      , mIndex(0){};
 
-    void updateKerning(std::u32string aAlphabet, Font* aFontFace);
+    GlyphMetrics(int32_t aAdvance, uint32_t aIndex)
+      : mAdvance(aAdvance)
+      , mIndex(aIndex){};
 
-    int64_t getKerning(char32_t c);
+    bool isLoaded() const { return mAdvance != UNKNOWN_ADVANCE; };
   };
 
+  static const int32_t UNKNOWN_ADVANCE = std::numeric_limits<int32_t>::min();
+  static const char32_t BMP_SIZE = 0x10000;
+
   // general font information
   std::string mName;
   std::string mStyle;
 
-  FT_Library mFTLib;
+  // the face is opened on first use if the metrics are precomputed
+  std::string mFontPath;
+  std::shared_ptr<const FontMetrics> mMetrics;
+  mutable bool mFaceOpen;
+  mutable FT_Library mFTLib;
   mutable FT_Face mFace;
 
   std::u32string mCurrentAlphabet;
 
-  // Glyph specific information
-  std::map<char32_t, Glyph> mAlphabet;
-  std::vector<std::vector<Kerning>> mKerning;
+  // glyphs of the basic multilingual plane, indexed by code point
+  std::vector<GlyphMetrics> mBmpGlyphs;
+  // open addressing table (linear probing) for the supplementary planes,
+  // a key of 0 marks an empty slot
+  std::vector<char32_t> mSupplementaryKeys;
+  std::vector<GlyphMetrics> mSupplementaryGlyphs;
+  std::size_t mSupplementaryCount;
+
+  // kerning of the (prev, next) pairs seen so far, computed on first use.
+  // Open addressing table (linear probing) keyed by (prev << 32 | next),
+  // EMPTY_KERNING_KEY marks an empty slot
+  static const uint64_t EMPTY_KERNING_KEY =
+    std::numeric_limits<uint64_t>::max();
+  bool mHasKerning;
+  std::vector<uint64_t> mKerningKeys;
+  std::vector<int32_t> mKerningValues;
+  std::size_t mKerningCount;
+
+  const GlyphMetrics& findGlyph(char32_t aChar) const
+  {
+    return (aChar < BMP_SIZE) ? mBmpGlyphs[aChar]
+                              : findSupplementaryGlyph(aChar);
+  };
+  const GlyphMetrics& findSupplementaryGlyph(char32_t aChar) const;
+  GlyphMetrics& insertSupplementaryGlyph(char32_t aChar);
+
+  void openFace() const;
+  const GlyphMetrics& loadGlyph(char32_t aChar);
+
+  int32_t getKerning(char32_t aPrev,
+                     uint32_t aPrevIndex,
+                     char32_t aNext,
+                     uint32_t aNextIndex);
+  int32_t computeKerning(uint32_t aPrevIndex, uint32_t aNextIndex) const;
+  void growKerningTable();
 
 public:
-  Font(const std::string& configPath);
+  /**
+   * Every font owns its FT_Library and FT_Face, so distinct instances can be
+   * used from distinct threads. A single instance is not thread-safe.
+   *
+   * If aMetrics is given, advances and kerning are read from it and FreeType
+   * is only initialized to create a font atlas. The metrics may be shared.
+   */
+  Font(const std::string& aFontPath,
+       std::shared_ptr<const FontMetrics> aMetrics = nullptr);
+  Font(const Font&) = delete;
+  Font& operator=(const Font&) = delete;
+  ~Font();
 
   int32_t computeTextLength(const std::u32string& aStr);
+  // length of the text [aBegin, aEnd), does not allocate once all glyphs of
+  // the text are loaded
+  int32_t computeTextLength(const char32_t* aBegin, const char32_t* aEnd);
+  /**
+   * Prefix lengths of the text [aBegin, aEnd): aPrefix[k] is the length of
+   * the first k characters and aKerning[k] the kerning between the characters
+   * k - 1 and k (0 for k = 0). Both vectors are resized to the text size + 1.
+   *
+   * The length of the text [s, e) with s < e is
+   * aPrefix[e] - aPrefix[s] - aKerning[s].
+   */
+  void computePrefixLengths(const char32_t* aBegin,
+                            const char32_t* aEnd,
+                            std::vector<int32_t>& aPrefix,
+                            std::vector<int32_t>& aKerning);
+  // add the characters of [aBegin, aEnd) to the alphabet without measuring
+  // the text, e.g. for labels taken from the label cache
+  void addToAlphabet(const char32_t* aBegin, const char32_t* aEnd);
 
   void createFontAtlas(const std::string& aName) const;
 
-  FT_Face* getFontFace() { return &mFace; };
+  /**
+   * Extract the advances of all characters of the font's cmap and the
+   * non-zero kerning of all pairs of their glyphs into a metrics file. Only
+   * the pairs of the sfnt kern table are queried; fonts without one are
+   * queried for all pairs, which is quadratic in the glyph count. The kerning
+   * is computed with aThreadCount threads.
+   */
+  static void writeMetrics(const std::string& aFontPath,
+                           uint64_t aFontHash,
+                           const std::string& aMetricsPath,
+                           int32_t aThreadCount);
+
+  FT_Face* getFontFace()
+  {
+    openFace();
+    return &mFace;
+  };
+  // all characters measured so far, in order of appearance
+  const std::u32string& getAlphabet() const { return mCurrentAlphabet; };
   int32_t getMeanLetterWidth() const;
 };
+
+/**
+ * Collect the glyph pairs of the sfnt kern table whose glyphs are both in
+ * aIndices (sorted) as keys prev << 32 | next. FT_Get_Kerning reads only the
+ * horizontal format 0 subtables of a version 0 table, so no other pair can
+ * have a kerning. Returns false if the face has no such table.
+ */
+bool readKerningPairs(FT_Face aFace,
+                      const std::vector<uint32_t>& aIndices,
+                      std::vector<uint64_t>& aPairs);
 } // namespace fonts
 
 #endif // FONT_H
@@ -0,0 +1,355 @@
+/*
+ * Font atlas with densely packed glyphs and a sparse kerning table
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fontatlas.h"
+
+#include <cairo/cairo.h>
+#include <json/json.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <math.h>
+#include <memory>
+#include <stdexcept>
+
+#include <omp.h>
+
+#include "font.h"
+#include "utf8helper.h"
+
+const int32_t fonts::PackedFontAtlas::PADDING;
+
+namespace fontatlas {
+const char KERNING_MAGIC[8] = { 'O', 'S', 'M', 'K', 'E', 'R', 'N', '1' };
+
+int32_t
+fromFP26_6(int64_t aFixPoint)
+{
+  return (int32_t)std::ceil((double)aFixPoint / 64);
+}
+
+void
+renderGlyph(FT_Face aFace, fonts::PackedFontAtlas::Glyph& aGlyph)
+{
+  aGlyph.mIndex = FT_Get_Char_Index(aFace, aGlyph.mChar);
+  auto error = FT_Load_Glyph(aFace, aGlyph.mIndex, FT_LOAD_RENDER);
+  if (error) {
+    throw std::runtime_error("Unable to load glyph: " +
+                             std::to_string(aGlyph.mChar) + "! Error was: " +
+                             std::to_string(error));
+  }
+
+  FT_GlyphSlot slot = aFace->glyph;
+  aGlyph.mAdvance = fromFP26_6(slot->metrics.horiAdvance);
+  aGlyph.mBearingX = slot->bitmap_left;
+  aGlyph.mBearingY = slot->bitmap_top;
+  aGlyph.mWidth = slot->bitmap.width;
+  aGlyph.mHeight = slot->bitmap.rows;
+
+  // the pitch is negative for bitmaps stored bottom up
+  int32_t pitch = std::abs(slot->bitmap.pitch);
+  aGlyph.mBitmap.resize((std::size_t)aGlyph.mWidth * aGlyph.mHeight);
+  for (int32_t row = 0; row < aGlyph.mHeight; ++row) {
+    int32_t srcRow =
+      (slot->bitmap.pitch >= 0) ? row : aGlyph.mHeight - 1 - row;
+    const unsigned char* src = slot->bitmap.buffer + srcRow * pitch;
+    std::memcpy(aGlyph.mBitmap.data() + (std::size_t)row * aGlyph.mWidth,
+                src,
+                aGlyph.mWidth);
+  }
+}
+
+// (glyph index, position in the glyphs) sorted by glyph index
+typedef std::vector<std::pair<uint32_t, std::size_t>> GlyphsByIndex;
+
+/**
+ * Add the kerning of the glyph indices aPrev and aNext for all pairs of
+ * characters mapped to them
+ */
+void
+addKerning(FT_Face aFace,
+           const std::vector<fonts::PackedFontAtlas::Glyph>& aGlyphs,
+           const GlyphsByIndex& aByIndex,
+           uint32_t aPrev,
+           uint32_t aNext,
+           std::vector<fonts::PackedFontAtlas::KerningPair>& aResult)
+{
+  FT_Vector value;
+  if (FT_Get_Kerning(aFace, aPrev, aNext, FT_KERNING_DEFAULT, &value) != 0) {
+    return;
+  }
+  int32_t k = fromFP26_6(value.x);
+  if (k == 0) {
+    return;
+  }
+
+  auto prev = std::lower_bound(
+    aByIndex.begin(), aByIndex.end(), std::make_pair(aPrev, std::size_t(0)));
+  for (; prev != aByIndex.end() && prev->first == aPrev; ++prev) {
+    auto next = std::lower_bound(
+      aByIndex.begin(), aByIndex.end(), std::make_pair(aNext, std::size_t(0)));
+    for (; next != aByIndex.end() && next->first == aNext; ++next) {
+      fonts::PackedFontAtlas::KerningPair pair;
+      pair.mPrev = (uint32_t)aGlyphs[prev->second].mChar;
+      pair.mNext = (uint32_t)aGlyphs[next->second].mChar;
+      pair.mKerning = k;
+      aResult.push_back(pair);
+    }
+  }
+}
+} // namespace fontatlas
+
+fonts::PackedFontAtlas::PackedFontAtlas(const std::string& aFontPath,
+                                        const std::u32string& aAlphabet,
+                                        int32_t aThreadCount)
+  : mWidth(0)
+  , mHeight(0)
+{
+  std::u32string alphabet = aAlphabet;
+  std::sort(alphabet.begin(), alphabet.end());
+  alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+
+  mGlyphs.resize(alphabet.size());
+  for (std::size_t i = 0; i < alphabet.size(); ++i) {
+    mGlyphs[i].mChar = alphabet[i];
+  }
+
+  // FreeType faces must not be shared between threads
+  int32_t threads = std::max(aThreadCount, 1);
+  std::vector<std::unique_ptr<Font>> fonts;
+  for (int32_t i = 0; i < threads; ++i) {
+    fonts.emplace_back(new Font(aFontPath));
+  }
+
+  FT_Face face = *fonts[0]->getFontFace();
+  mFontName = face->family_name;
+  mFontStyle = face->style_name;
+  mAscender = fontatlas::fromFP26_6(face->size->metrics.ascender);
+  mDescender = fontatlas::fromFP26_6(face->size->metrics.descender);
+  bool hasKerning = FT_HAS_KERNING(face);
+
+  std::vector<std::vector<KerningPair>> kerning(threads);
+  fontatlas::GlyphsByIndex byIndex;
+  std::vector<uint32_t> indices;
+  // kerning pairs of the kern table, all pairs are queried if not listed
+  std::vector<uint64_t> pairs;
+  bool listed = false;
+  std::exception_ptr error;
+#pragma omp parallel num_threads(threads)
+  {
+    FT_Face local = *fonts[omp_get_thread_num()]->getFontFace();
+    std::vector<KerningPair>& localKerning = kerning[omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 16)
+    for (int64_t i = 0; i < (int64_t)mGlyphs.size(); ++i) {
+      try {
+        fontatlas::renderGlyph(local, mGlyphs[i]);
+      } catch (...) {
+#pragma omp critical
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+
+    // the glyph indices are known after the implicit barrier
+#pragma omp single
+    if (hasKerning) {
+      for (std::size_t i = 0; i < mGlyphs.size(); ++i) {
+        byIndex.emplace_back(mGlyphs[i].mIndex, i);
+        indices.push_back(mGlyphs[i].mIndex);
+      }
+      std::sort(byIndex.begin(), byIndex.end());
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()),
+                    indices.end());
+      listed = fonts::readKerningPairs(local, indices, pairs);
+    }
+
+    // only the pairs of the kern table, all pairs of the alphabet's glyphs
+    // for fonts without one
+    if (hasKerning) {
+      int64_t rows = listed ? (int64_t)pairs.size() : (int64_t)indices.size();
+#pragma omp for schedule(dynamic, 16)
+      for (int64_t i = 0; i < rows; ++i) {
+        if (listed) {
+          fontatlas::addKerning(local,
+                                mGlyphs,
+                                byIndex,
+                                (uint32_t)(pairs[i] >> 32),
+                                (uint32_t)pairs[i],
+                                localKerning);
+        } else {
+          for (uint32_t next : indices) {
+            fontatlas::addKerning(
+              local, mGlyphs, byIndex, indices[i], next, localKerning);
+          }
+        }
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  for (const auto& pairs : kerning) {
+    mKerning.insert(mKerning.end(), pairs.begin(), pairs.end());
+  }
+  std::sort(mKerning.begin(),
+            mKerning.end(),
+            [](const KerningPair& aLhs, const KerningPair& aRhs) {
+              return aLhs.mPrev < aRhs.mPrev ||
+                     (aLhs.mPrev == aRhs.mPrev && aLhs.mNext < aRhs.mNext);
+            });
+
+  pack();
+}
+
+void
+fonts::PackedFontAtlas::pack()
+{
+  // next fit shelf packing in order of decreasing height
+  std::vector<std::size_t> order;
+  int64_t area = 0;
+  int32_t maxWidth = 0;
+  for (std::size_t i = 0; i < mGlyphs.size(); ++i) {
+    mGlyphs[i].mX = 0;
+    mGlyphs[i].mY = 0;
+    if (mGlyphs[i].mWidth > 0 && mGlyphs[i].mHeight > 0) {
+      order.push_back(i);
+      area += (int64_t)(mGlyphs[i].mWidth + PADDING) *
+              (mGlyphs[i].mHeight + PADDING);
+      maxWidth = std::max(maxWidth, mGlyphs[i].mWidth + PADDING);
+    }
+  }
+  std::sort(
+    order.begin(), order.end(), [this](std::size_t aLhs, std::size_t aRhs) {
+      const Glyph& lhs = mGlyphs[aLhs];
+      const Glyph& rhs = mGlyphs[aRhs];
+      return lhs.mHeight > rhs.mHeight ||
+             (lhs.mHeight == rhs.mHeight && lhs.mWidth > rhs.mWidth);
+    });
+
+  // aim for a square atlas
+  mWidth = std::max(maxWidth, (int32_t)std::ceil(std::sqrt((double)area)));
+  mHeight = 0;
+
+  int32_t shelfY = 0;
+  int32_t shelfHeight = 0;
+  int32_t x = 0;
+  for (std::size_t i : order) {
+    Glyph& glyph = mGlyphs[i];
+    if (x + glyph.mWidth + PADDING > mWidth) {
+      shelfY += shelfHeight;
+      shelfHeight = 0;
+      x = 0;
+    }
+    glyph.mX = x;
+    glyph.mY = shelfY;
+    x += glyph.mWidth + PADDING;
+    shelfHeight = std::max(shelfHeight, glyph.mHeight + PADDING);
+  }
+  mHeight = shelfY + shelfHeight;
+}
+
+void
+fonts::PackedFontAtlas::write(const std::string& aName) const
+{
+  // atlas image
+  if (mWidth > 0 && mHeight > 0) {
+    int32_t stride = cairo_format_stride_for_width(CAIRO_FORMAT_A8, mWidth);
+    std::vector<unsigned char> data((std::size_t)stride * mHeight, 0);
+    for (const Glyph& glyph : mGlyphs) {
+      for (int32_t row = 0; row < glyph.mHeight; ++row) {
+        std::memcpy(data.data() + (std::size_t)(glyph.mY + row) * stride +
+                      glyph.mX,
+                    glyph.mBitmap.data() + (std::size_t)row * glyph.mWidth,
+                    glyph.mWidth);
+      }
+    }
+
+    cairo_surface_t* surface = cairo_image_surface_create_for_data(
+      data.data(), CAIRO_FORMAT_A8, mWidth, mHeight, stride);
+    std::string path = aName + ".png";
+    cairo_surface_write_to_png(surface, path.c_str());
+    cairo_surface_destroy(surface);
+  }
+
+  // kerning table
+  {
+    std::ofstream output(aName + ".kern", std::ios::binary);
+    uint32_t count[2] = { (uint32_t)mKerning.size(), 0 };
+    output.write(fontatlas::KERNING_MAGIC, sizeof(fontatlas::KERNING_MAGIC));
+    output.write(reinterpret_cast<const char*>(count), sizeof(count));
+    for (const KerningPair& pair : mKerning) {
+      uint32_t record[3] = { pair.mPrev, pair.mNext, (uint32_t)pair.mKerning };
+      output.write(reinterpret_cast<const char*>(record), sizeof(record));
+    }
+    if (!output) {
+      throw std::runtime_error("Unable to write the kerning table " + aName +
+                               ".kern!");
+    }
+  }
+
+  // index
+  std::u32string alphabet;
+  int32_t topHeight = 0;
+  int32_t bottomHeight = 0;
+  Json::Value glyphs = Json::arrayValue;
+  for (const Glyph& glyph : mGlyphs) {
+    alphabet += glyph.mChar;
+    topHeight = std::max(topHeight, glyph.mBearingY);
+    bottomHeight = std::max(bottomHeight, glyph.mHeight - glyph.mBearingY);
+
+    Json::Value g = Json::arrayValue;
+    g.append(glyph.mX);
+    g.append(glyph.mY);
+    g.append(glyph.mWidth);
+    g.append(glyph.mHeight);
+    g.append(glyph.mBearingX);
+    g.append(glyph.mBearingY);
+    g.append(glyph.mAdvance);
+    glyphs.append(g);
+  }
+
+  Json::Value root;
+  root["atlas"]["name"] = aName;
+  root["atlas"]["width"] = mWidth;
+  root["atlas"]["height"] = mHeight;
+  root["font"]["name"] = mFontName;
+  root["font"]["style"] = mFontStyle;
+  root["glyph"]["ascender"] = mAscender;
+  root["glyph"]["descender"] = mDescender;
+  root["glyph"]["top_height"] = topHeight;
+  root["glyph"]["bottom_height"] = bottomHeight;
+  root["glyph"]["height"] = topHeight + bottomHeight;
+  root["alphabet"] = utf8_helper::UTF8Helper::toByteString(alphabet);
+  root["glyph_format"] = "x y width height bearing_x bearing_y advance";
+  root["glyphs"] = glyphs;
+  root["kerning"]["file"] = aName + ".kern";
+  root["kerning"]["pairs"] = (Json::UInt64)mKerning.size();
+
+  Json::FastWriter jsonWriter;
+  std::ofstream output(aName + ".info");
+  output << jsonWriter.write(root);
+}
@@ -0,0 +1,102 @@
+/*
+ * Font atlas with densely packed glyphs and a sparse kerning table
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FONTATLAS_H
+#define FONTATLAS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace fonts {
+
+/**
+ * Every glyph of the alphabet is rendered once, the glyphs are rendered in
+ * parallel using one face per thread. The bitmaps are packed into shelves
+ * of decreasing height.
+ *
+ * write() creates
+ *  - <name>.png: the A8 atlas image
+ *  - <name>.info: compact json index with the font metrics and the position,
+ *    size, bearing and advance of every glyph in alphabet order
+ *  - <name>.kern: the non-zero kerning pairs, sorted by (prev, next):
+ *    magic "OSMKERN1", uint32 count, uint32 0, then count records of
+ *    (uint32 prev char, uint32 next char, int32 kerning), native byte order
+ */
+class PackedFontAtlas
+{
+public:
+  struct Glyph
+  {
+    char32_t mChar;
+    uint32_t mIndex;
+
+    int32_t mAdvance;
+    int32_t mBearingX;
+    int32_t mBearingY;
+    int32_t mWidth;
+    int32_t mHeight;
+
+    // position in the atlas
+    int32_t mX;
+    int32_t mY;
+
+    // mWidth * mHeight coverage values
+    std::vector<unsigned char> mBitmap;
+  };
+
+  struct KerningPair
+  {
+    uint32_t mPrev;
+    uint32_t mNext;
+    int32_t mKerning;
+  };
+
+  PackedFontAtlas(const std::string& aFontPath,
+                  const std::u32string& aAlphabet,
+                  int32_t aThreadCount);
+
+  void write(const std::string& aName) const;
+
+  int32_t getWidth() const { return mWidth; };
+  int32_t getHeight() const { return mHeight; };
+  const std::vector<Glyph>& getGlyphs() const { return mGlyphs; };
+  const std::vector<KerningPair>& getKerning() const { return mKerning; };
+
+private:
+  // free pixels between neighbouring glyphs
+  static const int32_t PADDING = 1;
+
+  std::string mFontName;
+  std::string mFontStyle;
+  int32_t mAscender;
+  int32_t mDescender;
+
+  std::vector<Glyph> mGlyphs;
+  std::vector<KerningPair> mKerning;
+
+  int32_t mWidth;
+  int32_t mHeight;
+
+  void pack();
+};
+} // namespace fonts
+
+#endif // FONTATLAS_H
@@ -0,0 +1,218 @@
+/*
+ * Precomputed glyph advances and kerning of a font, stored in a binary file
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fontmetrics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fontmetrics {
+const char MAGIC[8] = { 'O', 'S', 'M', 'F', 'N', 'T', 'M', '1' };
+} // namespace fontmetrics
+
+fonts::FontMetrics::FontMetrics(const std::string& aPath)
+  : mData(nullptr)
+  , mSize(0)
+{
+  int fd = open(aPath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open the font metrics file: " + aPath +
+                             "!");
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (std::size_t)info.st_size < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error("Invalid font metrics file: " + aPath + "!");
+  }
+  mSize = info.st_size;
+  mData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mData == MAP_FAILED) {
+    mData = nullptr;
+    throw std::runtime_error("Unable to map the font metrics file: " + aPath +
+                             "!");
+  }
+
+  const char* data = static_cast<const char*>(mData);
+  mHeader = reinterpret_cast<const Header*>(data);
+  std::size_t kerningEnd =
+    sizeof(Header) + mHeader->mKerningCount * sizeof(KerningRecord);
+  std::size_t glyphEnd =
+    kerningEnd + (std::size_t)mHeader->mGlyphCount * sizeof(GlyphRecord);
+  if (std::memcmp(mHeader->mMagic,
+                  fontmetrics::MAGIC,
+                  sizeof(fontmetrics::MAGIC)) != 0 ||
+      mHeader->mKerningCount > mSize / sizeof(KerningRecord) ||
+      glyphEnd + mHeader->mNameSize + mHeader->mStyleSize != mSize) {
+    munmap(mData, mSize);
+    mData = nullptr;
+    throw std::runtime_error("Invalid font metrics file: " + aPath + "!");
+  }
+
+  mKerning = reinterpret_cast<const KerningRecord*>(data + sizeof(Header));
+  mGlyphs = reinterpret_cast<const GlyphRecord*>(data + kerningEnd);
+  mStrings = data + glyphEnd;
+}
+
+fonts::FontMetrics::~FontMetrics()
+{
+  if (mData) {
+    munmap(mData, mSize);
+  }
+}
+
+void
+fonts::FontMetrics::write(Content& aContent, const std::string& aPath)
+{
+  std::sort(aContent.mGlyphs.begin(),
+            aContent.mGlyphs.end(),
+            [](const GlyphRecord& aLhs, const GlyphRecord& aRhs) {
+              return aLhs.mChar < aRhs.mChar;
+            });
+  std::sort(aContent.mKerning.begin(),
+            aContent.mKerning.end(),
+            [](const KerningRecord& aLhs, const KerningRecord& aRhs) {
+              return aLhs.mKey < aRhs.mKey;
+            });
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.mMagic, fontmetrics::MAGIC, sizeof(header.mMagic));
+  header.mFontHash = aContent.mFontHash;
+  header.mXPpem = aContent.mXPpem;
+  header.mNotdefAdvance = aContent.mNotdefAdvance;
+  header.mHasKerning = aContent.mHasKerning ? 1 : 0;
+  const std::size_t maxCount = std::numeric_limits<uint32_t>::max();
+  if (aContent.mGlyphs.size() > maxCount || aContent.mName.size() > maxCount ||
+      aContent.mStyle.size() > maxCount) {
+    throw std::runtime_error("Too many glyphs or too long font name for the "
+                             "font metrics file: " +
+                             aPath + "!");
+  }
+  header.mGlyphCount = (uint32_t)aContent.mGlyphs.size();
+  header.mKerningCount = (uint64_t)aContent.mKerning.size();
+  header.mNameSize = (uint32_t)aContent.mName.size();
+  header.mStyleSize = (uint32_t)aContent.mStyle.size();
+
+  std::ofstream file(aPath, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to write the font metrics file: " + aPath +
+                             "!");
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(aContent.mKerning.data()),
+             aContent.mKerning.size() * sizeof(KerningRecord));
+  file.write(reinterpret_cast<const char*>(aContent.mGlyphs.data()),
+             aContent.mGlyphs.size() * sizeof(GlyphRecord));
+  file << aContent.mName << aContent.mStyle;
+  if (!file) {
+    throw std::runtime_error("Unable to write the font metrics file: " + aPath +
+                             "!");
+  }
+}
+
+uint64_t
+fonts::FontMetrics::getFontHash() const
+{
+  return mHeader->mFontHash;
+}
+
+std::string
+fonts::FontMetrics::getName() const
+{
+  return std::string(mStrings, mHeader->mNameSize);
+}
+
+std::string
+fonts::FontMetrics::getStyle() const
+{
+  return std::string(mStrings + mHeader->mNameSize, mHeader->mStyleSize);
+}
+
+int32_t
+fonts::FontMetrics::getXPpem() const
+{
+  return mHeader->mXPpem;
+}
+
+int32_t
+fonts::FontMetrics::getNotdefAdvance() const
+{
+  return mHeader->mNotdefAdvance;
+}
+
+bool
+fonts::FontMetrics::hasKerning() const
+{
+  return mHeader->mHasKerning != 0;
+}
+
+std::size_t
+fonts::FontMetrics::getGlyphCount() const
+{
+  return mHeader->mGlyphCount;
+}
+
+std::size_t
+fonts::FontMetrics::getKerningCount() const
+{
+  return mHeader->mKerningCount;
+}
+
+bool
+fonts::FontMetrics::findGlyph(char32_t aChar,
+                              int32_t& aAdvance,
+                              uint32_t& aIndex) const
+{
+  const GlyphRecord* end = mGlyphs + mHeader->mGlyphCount;
+  const GlyphRecord* it = std::lower_bound(
+    mGlyphs, end, aChar, [](const GlyphRecord& aRecord, char32_t aValue) {
+      return aRecord.mChar < aValue;
+    });
+  if (it == end || it->mChar != aChar) {
+    return false;
+  }
+
+  aAdvance = it->mAdvance;
+  aIndex = it->mIndex;
+  return true;
+}
+
+int32_t
+fonts::FontMetrics::getKerning(uint32_t aPrevIndex, uint32_t aNextIndex) const
+{
+  uint64_t key = ((uint64_t)aPrevIndex << 32) | (uint64_t)aNextIndex;
+  const KerningRecord* end = mKerning + mHeader->mKerningCount;
+  const KerningRecord* it = std::lower_bound(
+    mKerning, end, key, [](const KerningRecord& aRecord, uint64_t aValue) {
+      return aRecord.mKey < aValue;
+    });
+
+  return (it != end && it->mKey == key) ? it->mKerning : 0;
+}
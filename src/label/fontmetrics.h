@@ -0,0 +1,115 @@
+/*
+ * Precomputed glyph advances and kerning of a font, stored in a binary file
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FONTMETRICS_H
+#define FONTMETRICS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace fonts {
+
+/**
+ * Read only view of a font metrics file, the file is mapped into memory.
+ *
+ * Layout (native byte order): a Header, the kerning records sorted by key,
+ * the glyph records sorted by character, the font name and the style name.
+ */
+class FontMetrics
+{
+public:
+  struct GlyphRecord
+  {
+    uint32_t mChar;
+    int32_t mAdvance;
+    uint32_t mIndex;
+  };
+
+  struct KerningRecord
+  {
+    // (previous glyph index << 32 | next glyph index)
+    uint64_t mKey;
+    int32_t mKerning;
+    int32_t mPadding;
+  };
+
+  /**
+   * Everything written to a metrics file. Glyphs and kerning records may be
+   * unsorted, only non-zero kernings have to be given.
+   */
+  struct Content
+  {
+    uint64_t mFontHash;
+    std::string mName;
+    std::string mStyle;
+    int32_t mXPpem;
+    int32_t mNotdefAdvance;
+    bool mHasKerning;
+    std::vector<GlyphRecord> mGlyphs;
+    std::vector<KerningRecord> mKerning;
+  };
+
+  FontMetrics(const std::string& aPath);
+  FontMetrics(const FontMetrics&) = delete;
+  FontMetrics& operator=(const FontMetrics&) = delete;
+  ~FontMetrics();
+
+  static void write(Content& aContent, const std::string& aPath);
+
+  uint64_t getFontHash() const;
+  std::string getName() const;
+  std::string getStyle() const;
+  int32_t getXPpem() const;
+  // advance of the glyph used for characters missing in the font
+  int32_t getNotdefAdvance() const;
+  bool hasKerning() const;
+  std::size_t getGlyphCount() const;
+  std::size_t getKerningCount() const;
+
+  // false if the font maps no glyph to aChar
+  bool findGlyph(char32_t aChar, int32_t& aAdvance, uint32_t& aIndex) const;
+  int32_t getKerning(uint32_t aPrevIndex, uint32_t aNextIndex) const;
+
+private:
+  struct Header
+  {
+    char mMagic[8];
+    uint64_t mFontHash;
+    int32_t mXPpem;
+    int32_t mNotdefAdvance;
+    uint32_t mHasKerning;
+    uint32_t mGlyphCount;
+    uint64_t mKerningCount;
+    uint32_t mNameSize;
+    uint32_t mStyleSize;
+  };
+
+  void* mData;
+  std::size_t mSize;
+
+  const Header* mHeader;
+  const KerningRecord* mKerning;
+  const GlyphRecord* mGlyphs;
+  const char* mStrings;
+};
+} // namespace fonts
+
+#endif // FONTMETRICS_H
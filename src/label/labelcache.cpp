@@ -0,0 +1,202 @@
+/*
+ * Concurrent memo of measured and split labels
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "labelcache.h"
+
+#include <cstring>
+#include <fstream>
+
+const std::size_t label_helper::LabelCache::SHARD_COUNT;
+
+namespace labelcache {
+const char MAGIC[8] = { 'O', 'S', 'M', 'L', 'B', 'L', 'C', '1' };
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+template <typename T>
+void
+writeValue(std::ofstream& aFile, const T& aValue)
+{
+  aFile.write(reinterpret_cast<const char*>(&aValue), sizeof(T));
+}
+
+template <typename T>
+bool
+readValue(std::ifstream& aFile, T& aValue)
+{
+  return (bool)aFile.read(reinterpret_cast<char*>(&aValue), sizeof(T));
+}
+
+void
+writeString(std::ofstream& aFile, const std::string& aStr)
+{
+  writeValue(aFile, (uint32_t)aStr.size());
+  aFile.write(aStr.data(), aStr.size());
+}
+
+bool
+readString(std::ifstream& aFile, std::string& aStr)
+{
+  uint32_t size;
+  if (!readValue(aFile, size)) {
+    return false;
+  }
+  aStr.resize(size);
+  return size == 0 || (bool)aFile.read(&aStr[0], size);
+}
+} // namespace labelcache
+
+label_helper::LabelCache::LabelCache(uint64_t aSignature)
+  : mSignature(aSignature)
+  , mShards(new Shard[SHARD_COUNT])
+  , mHits(0)
+  , mMisses(0)
+{
+}
+
+label_helper::LabelCache::Shard&
+label_helper::LabelCache::getShard(const std::string& aName) const
+{
+  return mShards[std::hash<std::string>()(aName) % SHARD_COUNT];
+}
+
+bool
+label_helper::LabelCache::find(const std::string& aName, Entry& aEntry) const
+{
+  Shard& shard = getShard(aName);
+  std::unique_lock<std::mutex> lck(shard.mLock);
+  auto it = shard.mEntries.find(aName);
+  if (it == shard.mEntries.end()) {
+    ++mMisses;
+    return false;
+  }
+
+  aEntry = it->second;
+  ++mHits;
+  return true;
+}
+
+void
+label_helper::LabelCache::insert(const std::string& aName, const Entry& aEntry)
+{
+  Shard& shard = getShard(aName);
+  std::unique_lock<std::mutex> lck(shard.mLock);
+  shard.mEntries.emplace(aName, aEntry);
+}
+
+std::size_t
+label_helper::LabelCache::size() const
+{
+  std::size_t result = 0;
+  for (std::size_t i = 0; i < SHARD_COUNT; ++i) {
+    std::unique_lock<std::mutex> lck(mShards[i].mLock);
+    result += mShards[i].mEntries.size();
+  }
+
+  return result;
+}
+
+bool
+label_helper::LabelCache::load(const std::string& aPath)
+{
+  std::ifstream file(aPath, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(labelcache::MAGIC)];
+  uint64_t signature;
+  uint64_t count;
+  if (!file.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, labelcache::MAGIC, sizeof(magic)) != 0 ||
+      !labelcache::readValue(file, signature) || signature != mSignature ||
+      !labelcache::readValue(file, count)) {
+    return false;
+  }
+
+  std::string name;
+  Entry entry;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (!labelcache::readString(file, name) ||
+        !labelcache::readString(file, entry.mLabel) ||
+        !labelcache::readValue(file, entry.mFirstWidth) ||
+        !labelcache::readValue(file, entry.mSecondWidth)) {
+      return false;
+    }
+    insert(name, entry);
+  }
+
+  return true;
+}
+
+bool
+label_helper::LabelCache::save(const std::string& aPath) const
+{
+  std::ofstream file(aPath, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  file.write(labelcache::MAGIC, sizeof(labelcache::MAGIC));
+  labelcache::writeValue(file, mSignature);
+  labelcache::writeValue(file, (uint64_t)size());
+  for (std::size_t i = 0; i < SHARD_COUNT; ++i) {
+    std::unique_lock<std::mutex> lck(mShards[i].mLock);
+    for (const auto& entry : mShards[i].mEntries) {
+      labelcache::writeString(file, entry.first);
+      labelcache::writeString(file, entry.second.mLabel);
+      labelcache::writeValue(file, entry.second.mFirstWidth);
+      labelcache::writeValue(file, entry.second.mSecondWidth);
+    }
+  }
+
+  return (bool)file;
+}
+
+uint64_t
+label_helper::LabelCache::hashBytes(const char* aData,
+                                    std::size_t aSize,
+                                    uint64_t aSeed)
+{
+  uint64_t hash = aSeed;
+  for (std::size_t i = 0; i < aSize; ++i) {
+    hash ^= (unsigned char)aData[i];
+    hash *= labelcache::FNV_PRIME;
+  }
+
+  return hash;
+}
+
+uint64_t
+label_helper::LabelCache::hashFile(const std::string& aPath)
+{
+  std::ifstream file(aPath, std::ios::binary);
+  if (!file.is_open()) {
+    return 0;
+  }
+
+  uint64_t hash = labelcache::FNV_OFFSET;
+  std::vector<char> buffer(1 << 16);
+  while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+    hash = hashBytes(buffer.data(), file.gcount(), hash);
+  }
+
+  return hash;
+}
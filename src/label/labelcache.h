@@ -0,0 +1,95 @@
+/*
+ * Concurrent memo of measured and split labels
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LABELCACHE_H
+#define LABELCACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace label_helper {
+
+/**
+ * Memo from a poi name to its (possibly split) label and the widths of the
+ * label lines. The entries are only valid for one font, split bound and set
+ * of split delimiters; these are folded into the signature, a cache file
+ * with a different signature is ignored.
+ *
+ * The map is split into shards with one mutex each, so the label workers
+ * rarely contend.
+ */
+class LabelCache
+{
+public:
+  struct Entry
+  {
+    std::string mLabel;
+    int32_t mFirstWidth;
+    // -1 if the label consists of a single line
+    int32_t mSecondWidth;
+  };
+
+  LabelCache(uint64_t aSignature);
+
+  bool find(const std::string& aName, Entry& aEntry) const;
+  void insert(const std::string& aName, const Entry& aEntry);
+
+  std::size_t size() const;
+  uint64_t getHits() const { return mHits; };
+  uint64_t getMisses() const { return mMisses; };
+
+  /**
+   * Add the entries of a file written by save(). Returns false if the file
+   * can not be read or was written for a different signature.
+   */
+  bool load(const std::string& aPath);
+  bool save(const std::string& aPath) const;
+
+  // FNV-1a hash of the file content, 0 if the file can not be read
+  static uint64_t hashFile(const std::string& aPath);
+  static uint64_t hashBytes(const char* aData,
+                            std::size_t aSize,
+                            uint64_t aSeed);
+
+private:
+  static const std::size_t SHARD_COUNT = 64;
+
+  struct Shard
+  {
+    mutable std::mutex mLock;
+    std::unordered_map<std::string, Entry> mEntries;
+  };
+
+  uint64_t mSignature;
+  std::unique_ptr<Shard[]> mShards;
+
+  mutable std::atomic<uint64_t> mHits;
+  mutable std::atomic<uint64_t> mMisses;
+
+  Shard& getShard(const std::string& aName) const;
+};
+} // namespace label_helper
+
+#endif // LABELCACHE_H
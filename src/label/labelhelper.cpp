@@ -19,10 +19,19 @@
 
 #include "labelhelper.h"
 
+#include "fontatlas.h"
+#include "fontmetrics.h"
+#include "timer.h"
 #include "utf8helper.h"
 
+#include <cstdio>
+#include <algorithm>
+#include <exception>
 #include <limits>
 #include <math.h>
+#include <stdexcept>
+
+#include <omp.h>
 
 namespace label_helper {
 const char32_t NEWLINE = U'\u000A';
@@ -59,6 +68,43 @@ trim(const char32_t& aChar, std::u32string& aLabel)
   aLabel = aLabel.substr(0, idx + 1);
 }
 
+// replace every occurrence of aPattern by aChar in place, until none is left
+bool
+replaceAll(const std::u32string& aPattern,
+           char32_t aChar,
+           std::u32string& aLabel)
+{
+  bool replaced = false;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    std::size_t out = 0;
+    for (std::size_t in = 0; in < aLabel.size();) {
+      if (aLabel.compare(in, aPattern.size(), aPattern) == 0) {
+        aLabel[out++] = aChar;
+        in += aPattern.size();
+        changed = true;
+      } else {
+        aLabel[out++] = aLabel[in++];
+      }
+    }
+    aLabel.resize(out);
+    replaced = replaced || changed;
+  }
+
+  return replaced;
+}
+
+bool
+endsWithOneOf(const std::unordered_set<std::u32string>& aSuffixes,
+              std::size_t aLength,
+              const std::u32string& aLabel)
+{
+  return aLabel.size() >= aLength &&
+         aSuffixes.count(std::u32string(aLabel.end() - aLength, aLabel.end())) >
+           0;
+}
+
 std::pair<std::u32string, std::u32string>
 toLabelSplit(const std::u32string& aLabel,
              std::size_t aSplitPos,
@@ -85,11 +131,36 @@ toLabelSplit(const std::u32string& aLabel,
 label_helper::LabelHelper::LabelHelper(
   const std::string& aFontTTFPath,
   int32_t aSplitSize,
-  const std::unordered_set<char32_t>& aSplitPoints)
-  : mFont(aFontTTFPath)
-  , mSplitSizePx(aSplitSize * mFont.getMeanLetterWidth())
-  , mSplitPoints(aSplitPoints)
+  const std::unordered_set<char32_t>& aSplitPoints,
+  int32_t aWorkerCount,
+  const std::string& aMetricsPath)
+  : mSplitPoints(aSplitPoints)
+  , mFontTTFPath(aFontTTFPath)
 {
+  std::shared_ptr<const fonts::FontMetrics> metrics;
+  if (aMetricsPath != "") {
+    try {
+      metrics = std::make_shared<const fonts::FontMetrics>(aMetricsPath);
+      if (metrics->getFontHash() != LabelCache::hashFile(aFontTTFPath)) {
+        std::printf("The font metrics %s were created for a different font "
+                    "file.\n",
+                    aMetricsPath.c_str());
+        metrics.reset();
+      }
+    } catch (const std::runtime_error& e) {
+      std::printf("%s\n", e.what());
+    }
+    if (!metrics) {
+      std::printf("Measuring the labels with %s instead.\n",
+                  aFontTTFPath.c_str());
+    }
+  }
+
+  for (int32_t i = 0; i < std::max(aWorkerCount, 1); ++i) {
+    mFonts.emplace_back(new fonts::Font(aFontTTFPath, metrics));
+  }
+  mSplitSizePx = aSplitSize * mFonts[0]->getMeanLetterWidth();
+
   for (std::size_t i = 0; i < utf8_helper::UTF8Helper::BLANK_COUNT; ++i) {
     mSpaces.insert(utf8_helper::UTF8Helper::BLANK[i]);
   }
@@ -97,28 +168,60 @@ label_helper::LabelHelper::LabelHelper(
   for (std::size_t i = 0; i < utf8_helper::UTF8Helper::NEWLINE_COUNT; ++i) {
     mNewLines.insert(utf8_helper::UTF8Helper::NEWLINE[i]);
   }
+
+  // a sequence can only be replaced if its first character is present
+  for (const auto& seq : mSpaces) {
+    mSplitSpecials.insert(seq[0]);
+  }
+  for (const auto& seq : mNewLines) {
+    mSplitSpecials.insert(seq[0]);
+  }
+  mSplitSpecials.erase(label_helper::SPACE);
+
+  mSplitBuffers.resize(mFonts.size());
 }
 
 label_helper::LabelHelper::LabelBall
-label_helper::LabelHelper::computeLabelBall(
-  const osm_input::OsmPoi& aOsmPoi) const
+label_helper::LabelHelper::computeLabelBall(const osm_input::OsmPoi& aOsmPoi,
+                                            std::size_t aWorker) const
 {
   std::string label;
   double ballRadius = 1;
 
   if (aOsmPoi.getLevel()->mIconName != "") {
     label = "icon:" + aOsmPoi.getLevel()->mIconName;
-    ballRadius = mFont.getMeanLetterWidth();
+    ballRadius = mFonts[aWorker]->getMeanLetterWidth();
   } else {
-    int32_t l = computeLabelSize(aOsmPoi.getName());
-    if (l > mSplitSizePx) {
-      label = computeLabelSplit(aOsmPoi.getName());
+    const std::string& name = aOsmPoi.getName();
+    LabelCache::Entry entry;
+    // the name is decoded once, measured, split and measured again
+    std::u32string& text = mSplitBuffers[aWorker].mText;
+    utf8_helper::UTF8Helper::decode(
+      name.data(), name.data() + name.size(), text);
+    if (mLabelCache && mLabelCache->find(name, entry)) {
+      // the font atlas needs the characters of the cached labels too
+      mFonts[aWorker]->addToAlphabet(text.data(), text.data() + text.size());
     } else {
-      label = aOsmPoi.getName();
+      std::pair<int32_t, int32_t> size;
+      if (mFonts[aWorker]->computeTextLength(text) > mSplitSizePx) {
+        std::u32string split = splitLabel(text, mSplitPoints, aWorker);
+        utf8_helper::UTF8Helper::encode(
+          split.data(), split.data() + split.size(), entry.mLabel);
+        size = computeLineWidths(split, aWorker);
+      } else {
+        entry.mLabel = name;
+        size = computeLineWidths(text, aWorker);
+      }
+
+      entry.mFirstWidth = size.first;
+      entry.mSecondWidth = size.second;
+      if (mLabelCache) {
+        mLabelCache->insert(name, entry);
+      }
     }
 
-    std::pair<int32_t, int32_t> size = computeLabelSplitSize(label);
-    ballRadius = std::max(size.first, size.second) / 2;
+    label = entry.mLabel;
+    ballRadius = std::max(entry.mFirstWidth, entry.mSecondWidth) / 2;
   }
 
   ballRadius *= aOsmPoi.getLevel()->mLevelFactor;
@@ -134,142 +237,401 @@ label_helper::LabelHelper::computeLabelBall(
 }
 
 int32_t
-label_helper::LabelHelper::computeLabelSize(const std::string& aLabel) const
+label_helper::LabelHelper::computeLabelSize(const std::string& aLabel,
+                                            std::size_t aWorker) const
 {
   std::u32string label_u32 = utf8_helper::UTF8Helper::toUTF8String(aLabel);
 
-  return mFont.computeTextLength(label_u32);
+  return mFonts[aWorker]->computeTextLength(label_u32);
 }
 
 std::pair<int32_t, int32_t>
-label_helper::LabelHelper::computeLabelSplitSize(
-  const std::string& aLabel) const
+label_helper::LabelHelper::computeLabelSplitSize(const std::string& aLabel,
+                                                 std::size_t aWorker) const
 {
-  std::pair<int32_t, int32_t> result;
-  std::size_t splitPos = aLabel.find("\n");
+  std::u32string label_u32 = utf8_helper::UTF8Helper::toUTF8String(aLabel);
+
+  return computeLineWidths(label_u32, aWorker);
+}
+
+std::pair<int32_t, int32_t>
+label_helper::LabelHelper::computeLineWidths(const std::u32string& aLabel,
+                                             std::size_t aWorker) const
+{
+  fonts::Font& font = *mFonts[aWorker];
+  const char32_t* begin = aLabel.data();
+  const char32_t* end = begin + aLabel.size();
+
+  std::size_t splitPos = aLabel.find(label_helper::NEWLINE);
   if (splitPos == aLabel.npos) {
-    result = std::make_pair(computeLabelSize(aLabel), -1);
-  } else {
-    result = std::make_pair(computeLabelSize(aLabel.substr(0, splitPos)),
-                            computeLabelSize(aLabel.substr(splitPos + 1)));
+    return std::make_pair(font.computeTextLength(begin, end), -1);
   }
 
-  return result;
+  return std::make_pair(font.computeTextLength(begin, begin + splitPos),
+                        font.computeTextLength(begin + splitPos + 1, end));
 }
 
 std::string
-label_helper::LabelHelper::computeLabelSplit(const std::string& aLabel) const
+label_helper::LabelHelper::computeLabelSplit(const std::string& aLabel,
+                                             std::size_t aWorker) const
 {
-  return computeLabelSplit(aLabel, mSplitPoints);
+  return computeLabelSplit(aLabel, mSplitPoints, aWorker);
 }
 
 std::string
 label_helper::LabelHelper::computeLabelSplit(
   const std::string& aLabel,
-  const std::unordered_set<char32_t>& aDelims) const
+  const std::unordered_set<char32_t>& aDelims,
+  std::size_t aWorker) const
 {
   std::u32string label_u32 = utf8_helper::UTF8Helper::toUTF8String(aLabel);
 
+  return utf8_helper::UTF8Helper::toByteString(
+    splitLabel(label_u32, aDelims, aWorker));
+}
+
+std::u32string
+label_helper::LabelHelper::splitLabel(
+  std::u32string& aLabel,
+  const std::unordered_set<char32_t>& aDelims,
+  std::size_t aWorker) const
+{
   // remove trailing newline information
-  std::u32string s = label_u32.substr(label_u32.size() - 2);
-  if (mNewLines.count(label_u32.substr(label_u32.size() - 2)) > 0) {
-    label_u32 = label_u32.substr(0, label_u32.size() - 1);
+  if (label_helper::endsWithOneOf(mNewLines, 2, aLabel)) {
+    aLabel.pop_back();
   }
-  s = label_u32.substr(label_u32.size() - 1);
-  if (mNewLines.count(label_u32.substr(label_u32.size() - 1)) > 0) {
-    label_u32 = label_u32.substr(0, label_u32.size() - 1);
+  if (label_helper::endsWithOneOf(mNewLines, 1, aLabel)) {
+    aLabel.pop_back();
   }
 
-  if (label_u32.size() <= 1) {
-    return utf8_helper::UTF8Helper::toByteString(label_u32);
+  if (aLabel.size() <= 1) {
+    return aLabel;
   }
 
-  std::u32string result = std::u32string();
-
   bool newlineInfoPresent = false;
   for (std::size_t idx = 0; idx < utf8_helper::UTF8Helper::NEWLINE_COUNT;
        ++idx) {
-    std::u32string newline = utf8_helper::UTF8Helper::NEWLINE[idx];
+    const std::u32string& newline = utf8_helper::UTF8Helper::NEWLINE[idx];
 
     if (aDelims.count(newline[0]) > 0) {
       // don't replace newline if it is the SZ_NEWLINE
       continue;
     }
 
-    if (label_u32.find(newline) != label_u32.npos &&
-        newline == label_helper::SZ_NEWLINE) {
-      newlineInfoPresent = true;
+    if (newline == label_helper::SZ_NEWLINE) {
+      if (aLabel.find(newline) != aLabel.npos) {
+        newlineInfoPresent = true;
+      }
       continue;
     }
 
-    while (label_u32.find(newline) != label_u32.npos) {
+    if (label_helper::replaceAll(newline, label_helper::NEWLINE, aLabel)) {
       newlineInfoPresent = true;
-      label_u32 = label_u32.replace(
-        label_u32.find(newline), newline.size(), label_helper::SZ_NEWLINE);
     }
   }
 
   if (newlineInfoPresent) {
     std::unordered_set<char32_t> delim;
     delim.insert(label_helper::NEWLINE);
-    return computeLabelSplit(utf8_helper::UTF8Helper::toByteString(label_u32),
-                             delim);
+    return splitLabel(aLabel, delim, aWorker);
   }
 
   // we realy need to do work here ...
+  SplitBuffers& buf = mSplitBuffers[aWorker];
+  const char32_t* text = aLabel.data();
+  std::size_t size = aLabel.size();
+
+  mFonts[aWorker]->computePrefixLengths(
+    text, text + size, buf.mPrefix, buf.mKerning);
+  buf.mPlain = true;
+  buf.mNextNonSpace.resize(size + 1);
+  buf.mLastNonSpaceEnd.resize(size + 1);
+  buf.mLastNonSpaceEnd[0] = 0;
+  for (std::size_t k = 0; k < size; ++k) {
+    if (text[k] != label_helper::SPACE && mSplitSpecials.count(text[k]) > 0) {
+      buf.mPlain = false;
+    }
+    buf.mLastNonSpaceEnd[k + 1] =
+      (text[k] != label_helper::SPACE) ? k + 1 : buf.mLastNonSpaceEnd[k];
+  }
+  buf.mNextNonSpace[size] = size;
+  for (std::size_t k = size; k-- > 0;) {
+    buf.mNextNonSpace[k] =
+      (text[k] != label_helper::SPACE) ? k : buf.mNextNonSpace[k + 1];
+  }
 
-  // compute the median character
-  int32_t length = mFont.computeTextLength(label_u32);
-  std::size_t index = 0;
-  while (mFont.computeTextLength(label_u32.substr(0, index)) < length / 2) {
-    ++index;
+  // compute the median character: the first prefix of at least half the
+  // length. Binary search unless negative kerning made the prefixes shrink.
+  int32_t half = buf.mPrefix[size] / 2;
+  std::size_t index;
+  if (std::is_sorted(buf.mPrefix.begin(), buf.mPrefix.end())) {
+    index = std::lower_bound(buf.mPrefix.begin(), buf.mPrefix.end(), half) -
+            buf.mPrefix.begin();
+  } else {
+    index = 0;
+    while (buf.mPrefix[index] < half) {
+      ++index;
+    }
   }
+
   // now index points to the median element
-  if (aDelims.count(label_u32[index]) > 0) {
-    auto split = toLabelSplit(label_u32, index, mSpaces, mNewLines);
-    result = split.first + label_helper::NEWLINE + split.second;
-  } else {
-    // compute the best split if split point is in the first half
-    std::pair<std::u32string, std::u32string> splitFirst;
-    int32_t sizeSplitFirst = std::numeric_limits<int32_t>::max();
-    for (size_t i = index - 1; i > 0; --i) {
-      if (aDelims.count(label_u32[i]) > 0) {
-        splitFirst = toLabelSplit(label_u32, i, mSpaces, mNewLines);
-        sizeSplitFirst = std::max(mFont.computeTextLength(splitFirst.first),
-                                  mFont.computeTextLength(splitFirst.second));
-        break;
+  if (index < size && aDelims.count(aLabel[index]) > 0) {
+    return buildSplit(aLabel, index, aWorker);
+  }
+
+  // compute the best split if split point is in the first half
+  std::size_t splitFirst = 0;
+  int32_t sizeSplitFirst = std::numeric_limits<int32_t>::max();
+  for (std::size_t i = index - 1; index > 0 && i > 0; --i) {
+    if (aDelims.count(aLabel[i]) > 0) {
+      splitFirst = i;
+      sizeSplitFirst = evaluateSplit(aLabel, i, aWorker);
+      break;
+    }
+  }
+
+  std::size_t splitSecond = 0;
+  int32_t sizeSplitSecond = std::numeric_limits<int32_t>::max();
+  for (std::size_t i = index + 1; i < size; ++i) {
+    if (aDelims.count(aLabel[i]) > 0) {
+      splitSecond = i;
+      sizeSplitSecond = evaluateSplit(aLabel, i, aWorker);
+      break;
+    }
+  }
+
+  if (sizeSplitFirst != std::numeric_limits<int32_t>::max() ||
+      sizeSplitSecond != std::numeric_limits<int32_t>::max()) {
+    return buildSplit(aLabel,
+                      (sizeSplitFirst < sizeSplitSecond) ? splitFirst
+                                                         : splitSecond,
+                      aWorker);
+  }
+
+  // can't find any viable label split
+  return aLabel;
+}
+
+int32_t
+label_helper::LabelHelper::evaluateSplit(const std::u32string& aLabel,
+                                         std::size_t aPos,
+                                         std::size_t aWorker) const
+{
+  const SplitBuffers& buf = mSplitBuffers[aWorker];
+  std::size_t size = aLabel.size();
+
+  if (buf.mPlain) {
+    // both halves are only trimmed, measure them on the prefix lengths
+    int32_t result = 0;
+    std::size_t bounds[] = { 0, aPos + 1, size };
+    for (std::size_t h = 0; h < 2; ++h) {
+      std::size_t begin = buf.mNextNonSpace[bounds[h]];
+      std::size_t end = buf.mLastNonSpaceEnd[bounds[h + 1]];
+      if (begin < end) {
+        result = std::max(result,
+                          buf.mPrefix[end] - buf.mPrefix[begin] -
+                            buf.mKerning[begin]);
       }
     }
+    return result;
+  }
 
-    std::pair<std::u32string, std::u32string> splitSecond;
-    int32_t sizeSplitSecond = std::numeric_limits<int32_t>::max();
-    for (size_t i = index + 1; i < label_u32.size(); ++i) {
-      if (aDelims.count(label_u32[i]) > 0) {
-        splitSecond = toLabelSplit(label_u32, i, mSpaces, mNewLines);
-        sizeSplitSecond = std::max(mFont.computeTextLength(splitSecond.first),
-                                   mFont.computeTextLength(splitSecond.second));
-        break;
+  auto split = toLabelSplit(aLabel, aPos, mSpaces, mNewLines);
+  fonts::Font& font = *mFonts[aWorker];
+  return std::max(font.computeTextLength(split.first),
+                  font.computeTextLength(split.second));
+}
+
+std::u32string
+label_helper::LabelHelper::buildSplit(const std::u32string& aLabel,
+                                      std::size_t aPos,
+                                      std::size_t aWorker) const
+{
+  const SplitBuffers& buf = mSplitBuffers[aWorker];
+  std::size_t size = aLabel.size();
+
+  if (buf.mPlain) {
+    std::u32string result;
+    result.reserve(size + 1);
+    std::size_t bounds[] = { 0, aPos + 1, size };
+    for (std::size_t h = 0; h < 2; ++h) {
+      if (h == 1) {
+        result += label_helper::NEWLINE;
+      }
+      std::size_t begin = buf.mNextNonSpace[bounds[h]];
+      std::size_t end = buf.mLastNonSpaceEnd[bounds[h + 1]];
+      if (begin < end) {
+        result.append(aLabel, begin, end - begin);
       }
     }
+    return result;
+  }
 
-    if (sizeSplitFirst != std::numeric_limits<int32_t>::max() ||
-        sizeSplitSecond != std::numeric_limits<int32_t>::max()) {
-      if (sizeSplitFirst < sizeSplitSecond) {
-        result = splitFirst.first + label_helper::NEWLINE + splitFirst.second;
-      } else {
-        result = splitSecond.first + label_helper::NEWLINE + splitSecond.second;
+  auto split = toLabelSplit(aLabel, aPos, mSpaces, mNewLines);
+  return split.first + label_helper::NEWLINE + split.second;
+}
+
+void
+label_helper::LabelHelper::writeFontMetrics(const std::string& aFontTTFPath,
+                                            const std::string& aMetricsPath,
+                                            int32_t aThreadCount)
+{
+  fonts::Font::writeMetrics(aFontTTFPath,
+                            LabelCache::hashFile(aFontTTFPath),
+                            aMetricsPath,
+                            aThreadCount);
+}
+
+bool
+label_helper::LabelHelper::enableLabelCache(const std::string& aPath)
+{
+  // the cached widths depend on the font file, the split bound and delimiters
+  uint64_t signature = LabelCache::hashFile(mFontTTFPath);
+  signature =
+    LabelCache::hashBytes(reinterpret_cast<const char*>(&mSplitSizePx),
+                          sizeof(mSplitSizePx),
+                          signature);
+  std::vector<char32_t> delims(mSplitPoints.begin(), mSplitPoints.end());
+  std::sort(delims.begin(), delims.end());
+  signature =
+    LabelCache::hashBytes(reinterpret_cast<const char*>(delims.data()),
+                          delims.size() * sizeof(char32_t),
+                          signature);
+
+  mLabelCache.reset(new LabelCache(signature));
+
+  return mLabelCache->load(aPath);
+}
+
+bool
+label_helper::LabelHelper::saveLabelCache(const std::string& aPath) const
+{
+  return mLabelCache && mLabelCache->save(aPath);
+}
+
+const label_helper::LabelCache*
+label_helper::LabelHelper::getLabelCache() const
+{
+  return mLabelCache.get();
+}
+
+void
+label_helper::LabelHelper::outputFontAtlas(std::string aAtlasName,
+                                           bool aPacked)
+{
+  // the atlas contains every character measured by any of the workers
+  fonts::Font& font = *mFonts[0];
+  for (std::size_t i = 1; i < mFonts.size(); ++i) {
+    font.computeTextLength(mFonts[i]->getAlphabet());
+  }
+
+  if (aPacked) {
+    fonts::PackedFontAtlas atlas(
+      mFontTTFPath, font.getAlphabet(), (int32_t)mFonts.size());
+    atlas.write(aAtlasName);
+  } else {
+    font.createFontAtlas(aAtlasName);
+  }
+}
+
+std::vector<label_helper::LabelHelper::LabelBall>
+label_helper::LabelHelper::computeLabelBalls(
+  const std::vector<osm_input::OsmPoi>& aPois) const
+{
+  const std::size_t BLOCK_SIZE = 4096;
+  int64_t blockCount = (aPois.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  std::vector<std::vector<LabelBall>> blocks(blockCount);
+
+  // exceptions must not leave the parallel region
+  std::exception_ptr error;
+#pragma omp parallel num_threads(mFonts.size())
+  {
+    std::size_t worker = omp_get_thread_num();
+#pragma omp for schedule(dynamic, 1)
+    for (int64_t b = 0; b < blockCount; ++b) {
+      std::size_t begin = b * BLOCK_SIZE;
+      std::size_t end = std::min(begin + BLOCK_SIZE, aPois.size());
+      std::vector<LabelBall>& block = blocks[b];
+      block.reserve(end - begin);
+      try {
+        for (std::size_t i = begin; i < end; ++i) {
+          block.push_back(computeLabelBall(aPois[i], worker));
+        }
+      } catch (...) {
+#pragma omp critical
+        if (!error) {
+          error = std::current_exception();
+        }
       }
-    } else {
-      // can't find any viable label split
-      result = label_u32;
     }
   }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  std::vector<LabelBall> result;
+  result.reserve(aPois.size());
+  for (auto& block : blocks) {
+    result.insert(result.end(),
+                  std::make_move_iterator(block.begin()),
+                  std::make_move_iterator(block.end()));
+  }
 
-  return utf8_helper::UTF8Helper::toByteString(result);
+  return result;
 }
 
 void
-label_helper::LabelHelper::outputFontAtlas(std::string aAtlasName)
+label_helper::LabelHelper::benchmarkTextLength(
+  const std::vector<osm_input::OsmPoi>& aPois,
+  std::size_t aMinMeasurements) const
 {
-  mFont.createFontAtlas(aAtlasName);
+  std::vector<std::u32string> labels;
+  std::size_t chars = 0;
+  for (const auto& poi : aPois) {
+    std::string name = poi.getName();
+    if (name != "") {
+      labels.push_back(utf8_helper::UTF8Helper::toUTF8String(name));
+      chars += labels.back().size();
+    }
+  }
+  if (labels.empty()) {
+    std::printf("No named pois to benchmark the text measurement with.\n");
+    return;
+  }
+
+  fonts::Font& font = *mFonts[0];
+  int64_t checksum = 0;
+
+  debug_timer::Timer t;
+  t.start();
+  // the first pass loads all glyphs
+  for (const auto& label : labels) {
+    checksum += font.computeTextLength(label);
+  }
+  t.createTimepoint();
+
+  std::size_t passes = std::max<std::size_t>(
+    1, (aMinMeasurements + labels.size() - 1) / labels.size());
+  for (std::size_t p = 0; p < passes; ++p) {
+    for (const auto& label : labels) {
+      checksum += font.computeTextLength(label);
+    }
+  }
+  t.stop();
+
+  std::vector<double> times = t.getTimes();
+  double measured = (double)(passes * labels.size());
+  std::printf("Text measurement benchmark over %lu names (%lu characters, "
+              "%lu glyphs):\n\tglyph loading pass: %4.3f seconds\n\t%lu "
+              "passes: %4.3f seconds, %4.1f ns per label, %4.1f ns per "
+              "character\n\t(checksum %ld)\n",
+              labels.size(),
+              chars,
+              font.getAlphabet().size(),
+              times[0],
+              passes,
+              times[1],
+              1e9 * times[1] / measured,
+              1e9 * times[1] / (double)(passes * chars),
+              checksum);
 }
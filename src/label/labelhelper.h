@@ -20,10 +20,13 @@
 #ifndef LABELHELPER_H
 #define LABELHELPER_H
 
+#include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "font.h"
+#include "labelcache.h"
 #include "osmpoi.h"
 
 namespace label_helper {
@@ -57,33 +60,117 @@ public:
   };
 
 private:
-  mutable fonts::Font mFont;
+  // one font per worker thread, the fonts cache their glyph metrics
+  std::vector<std::unique_ptr<fonts::Font>> mFonts;
   int32_t mSplitSizePx;
 
   const std::unordered_set<char32_t> mSplitPoints;
 
   std::unordered_set<std::u32string> mSpaces;
   std::unordered_set<std::u32string> mNewLines;
+  // first characters of all blank and newline sequences except the space
+  std::unordered_set<char32_t> mSplitSpecials;
+
+  // per label arrays of the label split, reused per worker
+  struct SplitBuffers
+  {
+    std::vector<int32_t> mPrefix;
+    std::vector<int32_t> mKerning;
+    // true if the label contains no special character (see mSplitSpecials),
+    // both halves of any split are only trimmed then
+    bool mPlain;
+    // first non-space character at or after k
+    std::vector<std::size_t> mNextNonSpace;
+    // end of the last non-space character before k (0 if none)
+    std::vector<std::size_t> mLastNonSpaceEnd;
+    // the decoded label
+    std::u32string mText;
+  };
+  mutable std::vector<SplitBuffers> mSplitBuffers;
+
+  std::string mFontTTFPath;
+  // memo of split labels and line widths, null unless enabled
+  std::unique_ptr<LabelCache> mLabelCache;
+
+  std::u32string splitLabel(std::u32string& aLabel,
+                            const std::unordered_set<char32_t>& aDelims,
+                            std::size_t aWorker) const;
+  int32_t evaluateSplit(const std::u32string& aLabel,
+                        std::size_t aPos,
+                        std::size_t aWorker) const;
+  std::u32string buildSplit(const std::u32string& aLabel,
+                            std::size_t aPos,
+                            std::size_t aWorker) const;
+  // widths of the first and second line (-1 if there is none) of aLabel
+  std::pair<int32_t, int32_t> computeLineWidths(const std::u32string& aLabel,
+                                                std::size_t aWorker) const;
 
 public:
+  /**
+   * aWorkerCount is the number of threads that may use the helper at the same
+   * time. Each of them passes its worker index (0 <= aWorker < aWorkerCount)
+   * to the computations below.
+   *
+   * If aMetricsPath names a metrics file written by writeFontMetrics for the
+   * same font file, the labels are measured without FreeType.
+   */
   LabelHelper(const std::string& aFontTTFPath,
               int32_t aSplitSize,
-              const std::unordered_set<char32_t>& aSplitPoints);
-
-  LabelBall computeLabelBall(const osm_input::OsmPoi& aOsmPoi) const;
-  int32_t computeLabelSize(const std::string& aLabel) const;
+              const std::unordered_set<char32_t>& aSplitPoints,
+              int32_t aWorkerCount = 1,
+              const std::string& aMetricsPath = "");
+
+  static void writeFontMetrics(const std::string& aFontTTFPath,
+                               const std::string& aMetricsPath,
+                               int32_t aThreadCount);
+
+  LabelBall computeLabelBall(const osm_input::OsmPoi& aOsmPoi,
+                             std::size_t aWorker = 0) const;
+  int32_t computeLabelSize(const std::string& aLabel,
+                           std::size_t aWorker = 0) const;
   std::pair<int32_t, int32_t> computeLabelSplitSize(
-    const std::string& aLabel) const;
-
-  std::string computeLabelSplit(const std::string& aLabel) const;
-
-  std::string computeLabelSplit(
     const std::string& aLabel,
-    const std::unordered_set<char32_t>& aDelims) const;
+    std::size_t aWorker = 0) const;
+
+  std::string computeLabelSplit(const std::string& aLabel,
+                                std::size_t aWorker = 0) const;
+
+  std::string computeLabelSplit(const std::string& aLabel,
+                                const std::unordered_set<char32_t>& aDelims,
+                                std::size_t aWorker = 0) const;
+
+  /**
+   * Compute the label balls of all pois using all workers. The result has
+   * the order of aPois.
+   */
+  std::vector<LabelBall> computeLabelBalls(
+    const std::vector<osm_input::OsmPoi>& aPois) const;
+
+  /**
+   * Microbenchmark of the text measurement: the names of aPois are decoded
+   * once and measured repeatedly until at least aMinMeasurements labels were
+   * measured. Prints the glyph loading and the measurement times.
+   */
+  void benchmarkTextLength(const std::vector<osm_input::OsmPoi>& aPois,
+                           std::size_t aMinMeasurements) const;
+
+  /**
+   * Memoize the split label and line widths of every name. The entries of
+   * aPath are loaded if it was written for the same font, split bound and
+   * delimiters. Returns true if entries were loaded.
+   */
+  bool enableLabelCache(const std::string& aPath);
+  bool saveLabelCache(const std::string& aPath) const;
+  const LabelCache* getLabelCache() const;
 
   const std::unordered_set<char32_t>& getUnsupportedCharacters() const;
 
-  void outputFontAtlas(std::string aAtlasName);
+  /**
+   * Write the atlas of all characters measured so far. If aPacked is set the
+   * glyphs are packed densely and the kerning is written as a sparse binary
+   * table (see fonts::PackedFontAtlas).
+   */
+  void outputFontAtlas(std::string aAtlasName, bool aPacked = false);
 };
 } // namespace label_helper
 
@@ -19,6 +19,129 @@
 
 #include "utf8helper.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const char32_t utf8_helper::UTF8Helper::REPLACEMENT_CHARACTER;
+
+namespace utf8helper {
+const char32_t INVALID = 0xFFFFFFFF;
+
+/**
+ * Decode the sequence starting at aIn and advance aIn past it. Returns
+ * INVALID and advances by the maximal subpart if the sequence is malformed.
+ */
+inline char32_t
+decodeOne(const unsigned char*& aIn, const unsigned char* aEnd)
+{
+  unsigned char lead = *aIn++;
+  if (lead < 0x80) {
+    return lead;
+  }
+
+  // the valid range of the second byte depends on the lead byte, compare
+  // table 3-7 of the unicode standard
+  std::size_t length;
+  char32_t cp;
+  unsigned char lower = 0x80;
+  unsigned char upper = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 1;
+    cp = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 2;
+    cp = lead & 0x0F;
+    if (lead == 0xE0) {
+      lower = 0xA0;
+    } else if (lead == 0xED) {
+      upper = 0x9F;
+    }
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 3;
+    cp = lead & 0x07;
+    if (lead == 0xF0) {
+      lower = 0x90;
+    } else if (lead == 0xF4) {
+      upper = 0x8F;
+    }
+  } else {
+    return INVALID;
+  }
+
+  for (std::size_t i = 0; i < length; ++i) {
+    if (aIn == aEnd || *aIn < lower || *aIn > upper) {
+      return INVALID;
+    }
+    cp = (cp << 6) | (*aIn & 0x3F);
+    ++aIn;
+    lower = 0x80;
+    upper = 0xBF;
+  }
+
+  return cp;
+}
+
+/**
+ * Number of leading ASCII bytes of the 16 bytes at aIn
+ */
+#ifdef __SSE2__
+inline std::size_t
+countAscii16(const unsigned char* aIn)
+{
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aIn));
+  int mask = _mm_movemask_epi8(chunk);
+
+  return mask == 0 ? 16 : __builtin_ctz(mask);
+}
+
+// widen 16 ASCII bytes to 16 code points
+inline void
+widenAscii16(const unsigned char* aIn, char32_t* aOut)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aIn));
+  __m128i low = _mm_unpacklo_epi8(chunk, zero);
+  __m128i high = _mm_unpackhi_epi8(chunk, zero);
+
+  __m128i* out = reinterpret_cast<__m128i*>(aOut);
+  _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+  _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+  _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+  _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+}
+#endif
+
+/**
+ * Walk the code points of [aIn, aEnd): ASCII runs of 16 bytes are passed to
+ * aAscii16, every other code point (INVALID if malformed) to aCodePoint.
+ */
+template <typename AsciiFunc, typename CodePointFunc>
+inline void
+forEachCodePoint(const unsigned char* aIn,
+                 const unsigned char* aEnd,
+                 AsciiFunc aAscii16,
+                 CodePointFunc aCodePoint)
+{
+  while (aIn != aEnd) {
+#ifdef __SSE2__
+    if (aEnd - aIn >= 16) {
+      std::size_t ascii = countAscii16(aIn);
+      if (ascii == 16) {
+        aAscii16(aIn);
+        aIn += 16;
+        continue;
+      }
+      for (std::size_t i = 0; i < ascii; ++i) {
+        aCodePoint(*aIn++);
+      }
+    }
+#endif
+    aCodePoint(decodeOne(aIn, aEnd));
+  }
+}
+} // namespace utf8helper
+
 // TODO: Update NEWLINE_COUNT in the header file when changing the arrays
 const std::u32string utf8_helper::UTF8Helper::NEWLINE[] = {
   U"\u000D\u000A", // Carriage Return & Line Feed
@@ -54,14 +177,90 @@ const std::u32string utf8_helper::UTF8Helper::BLANK[] = {
   U"\u3000", // ideographic space
 };
 
+void
+utf8_helper::UTF8Helper::decode(const char* aBegin,
+                                const char* aEnd,
+                                std::u32string& aResult)
+{
+  // every byte yields at most one code point
+  aResult.resize(aEnd - aBegin);
+  if (aResult.empty()) {
+    return;
+  }
+
+  char32_t* out = &aResult[0];
+  utf8helper::forEachCodePoint(
+    reinterpret_cast<const unsigned char*>(aBegin),
+    reinterpret_cast<const unsigned char*>(aEnd),
+    [&out](const unsigned char* aAscii) {
+#ifdef __SSE2__
+      utf8helper::widenAscii16(aAscii, out);
+      out += 16;
+#endif
+    },
+    [&out](char32_t aCp) {
+      *out++ = aCp == utf8helper::INVALID ? REPLACEMENT_CHARACTER : aCp;
+    });
+
+  aResult.resize(out - aResult.data());
+}
+
+void
+utf8_helper::UTF8Helper::encode(const char32_t* aBegin,
+                                const char32_t* aEnd,
+                                std::string& aResult)
+{
+  aResult.clear();
+  aResult.reserve(aEnd - aBegin);
+
+  for (const char32_t* it = aBegin; it != aEnd; ++it) {
+    char32_t cp = *it;
+    if (cp < 0x80) {
+      aResult.push_back((char)cp);
+      continue;
+    }
+    if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+      cp = REPLACEMENT_CHARACTER;
+    }
+
+    if (cp < 0x800) {
+      aResult.push_back((char)(0xC0 | (cp >> 6)));
+    } else if (cp < 0x10000) {
+      aResult.push_back((char)(0xE0 | (cp >> 12)));
+      aResult.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+    } else {
+      aResult.push_back((char)(0xF0 | (cp >> 18)));
+      aResult.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+      aResult.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+    }
+    aResult.push_back((char)(0x80 | (cp & 0x3F)));
+  }
+}
+
 std::size_t
 utf8_helper::UTF8Helper::computeLengthUTF8(const std::string& aStr)
 {
-  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> convert;
+  std::size_t length = 0;
+  utf8helper::forEachCodePoint(
+    reinterpret_cast<const unsigned char*>(aStr.data()),
+    reinterpret_cast<const unsigned char*>(aStr.data() + aStr.size()),
+    [&length](const unsigned char*) { length += 16; },
+    [&length](char32_t) { ++length; });
+
+  return length;
+}
 
-  std::u32string ws = convert.from_bytes(aStr);
+bool
+utf8_helper::UTF8Helper::isValidUTF8(const std::string& aStr)
+{
+  bool valid = true;
+  utf8helper::forEachCodePoint(
+    reinterpret_cast<const unsigned char*>(aStr.data()),
+    reinterpret_cast<const unsigned char*>(aStr.data() + aStr.size()),
+    [](const unsigned char*) {},
+    [&valid](char32_t aCp) { valid = valid && aCp != utf8helper::INVALID; });
 
-  return ws.size();
+  return valid;
 }
 
 bool
@@ -107,15 +306,17 @@ utf8_helper::UTF8Helper::isNewLine(const std::u32string& aStr)
 std::u32string
 utf8_helper::UTF8Helper::toUTF8String(const std::string& aStr)
 {
-  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> convert;
+  std::u32string result;
+  decode(aStr.data(), aStr.data() + aStr.size(), result);
 
-  return convert.from_bytes(aStr);
+  return result;
 }
 
 std::string
 utf8_helper::UTF8Helper::toByteString(const std::u32string& aStr)
 {
-  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> convert;
+  std::string result;
+  encode(aStr.data(), aStr.data() + aStr.size(), result);
 
-  return convert.to_bytes(aStr);
+  return result;
 }
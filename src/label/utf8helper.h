@@ -20,9 +20,7 @@
 #ifndef UTF8HELPER_H
 #define UTF8HELPER_H
 
-#include <codecvt>
 #include <iostream>
-#include <locale>
 #include <string>
 #include <unordered_set>
 
@@ -38,8 +36,28 @@ public:
   static const std::size_t BLANK_COUNT = 18;
   static const std::u32string BLANK[];
 
+  static const char32_t REPLACEMENT_CHARACTER = U'\uFFFD';
+
 public:
+  /**
+   * Conversion between UTF-8 and UTF-32. Malformed input never throws: each
+   * maximal subpart of an ill-formed UTF-8 sequence (overlong forms,
+   * surrogates, code points beyond U+10FFFF, truncated sequences) is decoded
+   * to one REPLACEMENT_CHARACTER. Code points that can not be encoded are
+   * written as REPLACEMENT_CHARACTER as well.
+   *
+   * aResult is overwritten, its capacity is reused.
+   */
+  static void decode(const char* aBegin,
+                     const char* aEnd,
+                     std::u32string& aResult);
+  static void encode(const char32_t* aBegin,
+                     const char32_t* aEnd,
+                     std::string& aResult);
+
+  // number of code points decode produces for aStr
   static std::size_t computeLengthUTF8(const std::string& aStr);
+  static bool isValidUTF8(const std::string& aStr);
 
   static bool isBlank(char32_t c);
   static bool isBlank(const std::u32string& aStr);
@@ -31,14 +31,20 @@
 #include "mappinghelper.h"
 #include "osminputhelper.h"
 #include "osmpoi.h"
+#include "poiordering.h"
 #include "poistatistics.h"
+#include "poisetinput.h"
 #include "populationinput.h"
 #include "textoutputhelper.h"
+#include "tileexporter.h"
 #include "timer.h"
 #include "utf8helper.h"
 
 namespace {
 using ARG_TYPES = argumentparser::ArgumentParser::ARGUMENT_TYPES;
+
+// number of pois labeled and written at once
+const std::size_t LABEL_BATCH_SIZE = 1 << 20;
 }
 
 int
@@ -54,8 +60,11 @@ main(int argc, char** argv)
                            "--config",
                            "Defines the config file which guides the import.",
                            ARG_TYPES::STRING);
-  args.addArgumentRequired(
-    "-i", "--input", "path to the input .pbf file", ARG_TYPES::STRING);
+  args.addArgument("-i",
+                   "--input",
+                   "path to the input .pbf file. Required unless --reclassify "
+                   "is given.",
+                   ARG_TYPES::STRING);
   args.addArgumentRequired("-C",
                            "--config",
                            "Defines the config file which guides the import.",
@@ -67,21 +76,116 @@ main(int argc, char** argv)
                    "thread during the pbf import. "
                    "Default 2",
                    ARG_TYPES::INT);
+  args.addArgument("-bo",
+                   "--binaryoutput",
+                   "if set the label balls are additionally written to "
+                   "<labeling name>.balls.bin in the memory mappable binary "
+                   "format including a spatial index.",
+                   ARG_TYPES::BINARY);
+  args.addArgument("-bf",
+                   "--benchmarkfont",
+                   "if set the text measurement is benchmarked on the names of "
+                   "the imported pois and the program exits.",
+                   ARG_TYPES::BINARY);
+  args.addArgument("-df",
+                   "--derivefilter",
+                   "if set the pbf filter is derived from the mapping instead "
+                   "of using the filter block of the config. The selectivity "
+                   "of both filters is reported.",
+                   ARG_TYPES::BINARY);
   args.addArgument("-eh",
                    "--exporthierarchy",
                    "if set the hierarchy levels will be exported instead of a "
                    "total oder.",
                    ARG_TYPES::BINARY);
+  args.addArgument("-ep",
+                   "--exportpois",
+                   "if set the imported pois are written including their tags "
+                   "to <labeling name>.pois.txt. The file can be re-classified "
+                   "using --reclassify.",
+                   ARG_TYPES::BINARY);
   args.addArgument("-fa",
                    "--fontatlas",
                    "if set, the font information will be "
                    "outputted to a font file",
                    ARG_TYPES::BINARY);
+  args.addArgument("-lc",
+                   "--labelcache",
+                   "path to a label cache file. Split labels and their widths "
+                   "are read from and written to the file, it is ignored if "
+                   "it was created for a different font or split setting.",
+                   ARG_TYPES::STRING);
+  args.addArgument("-fm",
+                   "--fontmetrics",
+                   "path to a font metrics file written by --writemetrics. "
+                   "The labels are measured using the file instead of "
+                   "loading the glyphs of the font.",
+                   ARG_TYPES::STRING);
+  args.addArgument("-gz",
+                   "--gzip",
+                   "if set the complete, Hilbert order and binary output are "
+                   "gzip compressed while writing (.gz is appended to their "
+                   "names). The binary file has to be decompressed before "
+                   "it can be mapped.",
+                   ARG_TYPES::BINARY);
+  args.addArgument("-ho",
+                   "--hilbertorder",
+                   "if set the importance ranks of the balls are additionally "
+                   "written in the order of a Hilbert curve over their "
+                   "positions to <labeling name>.hilbert.txt.",
+                   ARG_TYPES::BINARY);
+  args.addArgument("-l",
+                   "--limit",
+                   "if set only the given number of most important pois is "
+                   "kept. The selection is done during the import, so only "
+                   "these pois are labeled and written.",
+                   ARG_TYPES::INT);
+  args.addArgument("-pa",
+                   "--packedatlas",
+                   "if set together with --fontatlas the glyphs are packed "
+                   "densely and the kerning is written to a sparse binary "
+                   "table.",
+                   ARG_TYPES::BINARY);
+  args.addArgument("-pm",
+                   "--profilemapping",
+                   "if set the mapping is profiled during the classification. "
+                   "Match counts and sampled evaluation times per rule are "
+                   "written to <labeling name>.profile.json / .csv",
+                   ARG_TYPES::BINARY);
+  args.addArgument("-rc",
+                   "--reclassify",
+                   "path to a poi file written by --exportpois. The pois are "
+                   "classified using the mapping of the given config instead "
+                   "of importing the .pbf file.",
+                   ARG_TYPES::STRING);
   args.addArgument(
     "-tc",
     "--threadcount",
-    "define the number of threads used during the pbf import. Default 4",
+    "define the number of threads used during the pbf import, the sorting "
+    "and the label computation. Default 4",
     ARG_TYPES::INT);
+  args.addArgument("-vt",
+                   "--vectortiles",
+                   "path of a Mapbox Vector Tile export of the label balls. "
+                   "A path ending with .mbtiles is written as MBTiles file, "
+                   "otherwise a directory tree <z>/<x>/<y>.pbf is created.",
+                   ARG_TYPES::STRING);
+  args.addArgument("-vmin",
+                   "--vectorminzoom",
+                   "smallest zoom of the vector tiles. Default 0",
+                   ARG_TYPES::INT);
+  args.addArgument("-vmax",
+                   "--vectormaxzoom",
+                   "largest zoom of the vector tiles. Default 14",
+                   ARG_TYPES::INT);
+  args.addArgument("-wm",
+                   "--writemetrics",
+                   "if set the advances and kerning of the config font are "
+                   "written to the given font metrics file and the program "
+                   "exits. The kerning of fonts without a kern table is "
+                   "queried for all glyph pairs, quadratic in the glyph "
+                   "count.",
+                   ARG_TYPES::STRING);
 
   try {
     if (!args.parseArguments(std::size_t(argc), argv) && !args.isSet("-h")) {
@@ -102,30 +206,112 @@ main(int argc, char** argv)
     return 0;
   }
 
+  if (args.isSet("-wm")) {
+    config_helper::ConfigHelper config(args.getValue<std::string>("-C"));
+    std::string metricsPath = args.getValue<std::string>("-wm");
+    int threadCount = (args.isSet("-tc")) ? args.getValue<int>("-tc") : 4;
+    std::printf("Writing font metrics to %s\n", metricsPath.c_str());
+    label_helper::LabelHelper::writeFontMetrics(
+      config.get_ttf_path(), metricsPath, threadCount);
+    return EXIT_SUCCESS;
+  }
+
+  if (!args.isSet("-i") && !args.isSet("-rc")) {
+    std::cerr << "Either an input .pbf file or a poi file to re-classify has "
+                 "to be given."
+              << std::endl
+              << args.programHelp() << std::endl;
+    return 1;
+  }
+
   // required arguments
-  std::string pbfPath = args.getValue<std::string>("-i");
+  std::string pbfPath =
+    (args.isSet("-i")) ? args.getValue<std::string>("-i") : "";
   config_helper::ConfigHelper config(args.getValue<std::string>("-C"));
 
   // optional arguments
   int threadCount = (args.isSet("-tc")) ? args.getValue<int>("-tc") : 4;
   int blobCount = (args.isSet("-bc")) ? args.getValue<int>("-bc") : 2;
+  int limit = (args.isSet("-l")) ? args.getValue<int>("-l") : 0;
+  if (limit < 0) {
+    std::cerr << "The poi limit must not be negative." << std::endl;
+    return 1;
+  }
 
   label_helper::LabelHelper labelHelper(config.get_ttf_path(),
                                         config.get_split_bound(),
-                                        config.get_split_delimiters());
+                                        config.get_split_delimiters(),
+                                        threadCount,
+                                        args.isSet("-fm")
+                                          ? args.getValue<std::string>("-fm")
+                                          : "");
 
   const mapping_helper::MappingHelper& mappingHelper =
     config.get_mapping_helper();
 
+  bool deriveFilter = args.isSet("-df");
+  if (deriveFilter) {
+    if (config.get_derived_filter_helper().has_filter()) {
+      Json::StyledWriter jsonWriter;
+      std::printf(
+        "Derived filter from the mapping:\n%s",
+        jsonWriter.write(mappingHelper.deriveFilter()).c_str());
+    } else {
+      std::printf("The mapping accepts every element, no filter could be "
+                  "derived. Using the config filter instead.\n");
+      deriveFilter = false;
+    }
+  }
+
   debug_timer::Timer t;
   t.start();
-  osm_input::OsmInputHelper input(pbfPath, config, threadCount, blobCount);
   std::vector<osm_input::OsmPoi> pois;
-  pois = input.importPoiData();
+  // sorted runs of the imported pois, empty if pois is unsorted
+  std::vector<std::size_t> runOffsets;
+  // the profile storage is only allocated if profiling is enabled
+  mapping_helper::MappingHelper::Profile mappingProfile;
+  if (args.isSet("-pm")) {
+    mappingProfile = mappingHelper.createProfile();
+  }
+  if (args.isSet("-rc")) {
+    poiset_input::PoiSetInput poiSet(args.getValue<std::string>("-rc"));
+    pois = poiSet.classifyPois(mappingHelper,
+                               threadCount,
+                               args.isSet("-pm") ? &mappingProfile : nullptr);
+
+    std::printf("Re-classified %lu stored pois, %lu were mapped to a level.\n",
+                poiSet.size(),
+                pois.size());
+    if (limit > 0) {
+      poi_ordering::keepMostImportant(
+        pois, limit, config.get_ranking(), threadCount);
+    }
+  } else {
+    osm_input::OsmInputHelper input(
+      pbfPath, config, threadCount, blobCount, deriveFilter);
+    if (args.isSet("-pm")) {
+      input.enableMappingProfile();
+    }
+    input.setLimit(limit);
+    // only the default ordering merges the runs of the import
+    input.setSortRuns(config.get_ranking().isDefault() && !args.isSet("-eh") &&
+                      limit == 0);
+    pois = input.importPoiData();
+    mappingProfile = input.getMappingProfile();
+    runOffsets = input.getRunOffsets();
+  }
 
   t.createTimepoint();
 
-  std::sort(pois.begin(), pois.end());
+  if (!config.get_ranking().isDefault()) {
+    poi_ordering::sortPois(pois, config.get_ranking(), threadCount);
+  } else if (args.isSet("-eh")) {
+    poi_ordering::sortPoisByLevel(pois, mappingHelper, threadCount);
+  } else if (runOffsets.empty()) {
+    poi_ordering::sortPois(pois, threadCount);
+  } else {
+    poi_ordering::sortPoiRuns(pois, runOffsets, threadCount);
+  }
 
   t.stop();
 
@@ -135,35 +321,152 @@ main(int argc, char** argv)
               t.getTimes()[0],
               t.getTimes()[1]);
 
-  if (args.isSet("-fa")) {
-    std::cout << "Writing font atlas to files ... " << std::endl;
+  if (args.isSet("-bf")) {
+    labelHelper.benchmarkTextLength(pois, 5000000);
+    return EXIT_SUCCESS;
+  }
 
-    labelHelper.outputFontAtlas(config.get_font_name());
+  if (args.isSet("-pm")) {
+    std::string profilepath = config.get_labeling_name();
+    std::replace(profilepath.begin(), profilepath.end(), ' ', '_');
+    std::printf("Writing mapping profile to %s.profile.json / .csv\n",
+                profilepath.c_str());
+    if (!mappingHelper.writeProfileReport(mappingProfile, profilepath)) {
+      std::printf("Could not write the mapping profile to %s.profile.json / "
+                  ".csv\n",
+                  profilepath.c_str());
+    }
+  }
 
-    std::cout << "... successfull!" << std::endl;
+  if (args.isSet("-ep")) {
+    std::string poipath = config.get_labeling_name() + ".pois.txt";
+    std::replace(poipath.begin(), poipath.end(), ' ', '_');
+    std::printf("Writing pois to %s\n", poipath.c_str());
+    text_output::TextOutputHelper outPois(poipath);
+    outPois.writePoiFile(pois);
   }
 
-  std::cout << "Creating label discs ..." << std::endl;
+  std::cout << "Creating and exporting label discs ..." << std::endl;
 
+  if (args.isSet("-lc")) {
+    if (labelHelper.enableLabelCache(args.getValue<std::string>("-lc"))) {
+      std::printf("Loaded %lu cached labels.\n",
+                  labelHelper.getLabelCache()->size());
+    }
+  }
+
+  // the output helper compresses files with a .gz extension
+  std::string compressExt = (args.isSet("-gz")) ? ".gz" : "";
+  std::string outputpath =
+    config.get_labeling_name() + ".complete.txt" + compressExt;
+  std::replace(outputpath.begin(), outputpath.end(), ' ', '_');
+  std::printf("Outputting data to %s\n", outputpath.c_str());
+  text_output::TextOutputHelper outComplete(outputpath, threadCount);
+  if (!outComplete.beginCompleteFile(' ', args.isSet("-eh"))) {
+    std::cerr << "Could not open " << outputpath << std::endl;
+    return 1;
+  }
+
+  // the balls are computed and written in batches, the names and tags of the
+  // labeled pois are released after every batch. Only the binary output and
+  // the vector tiles need all balls at once.
   std::vector<label_helper::LabelHelper::LabelBall> balls;
-  balls.reserve(pois.size());
-  std::size_t count = 0;
-  for (const auto& poi : pois) {
-    balls.push_back(labelHelper.computeLabelBall(poi));
-    ++count;
+  std::vector<osm_input::OsmPoi::Position> positions;
+  bool success = true;
+  for (std::size_t begin = 0; begin < pois.size(); begin += LABEL_BATCH_SIZE) {
+    std::size_t end = std::min(begin + LABEL_BATCH_SIZE, pois.size());
+    std::vector<osm_input::OsmPoi> batch(
+      std::make_move_iterator(pois.begin() + begin),
+      std::make_move_iterator(pois.begin() + end));
+    std::vector<label_helper::LabelHelper::LabelBall> batchBalls =
+      labelHelper.computeLabelBalls(batch);
+    batch.clear();
+
+    success = outComplete.appendCompleteFile(batchBalls) && success;
+    if (args.isSet("-ho")) {
+      for (const auto& ball : batchBalls) {
+        positions.push_back(ball.mPos);
+      }
+    }
+    if (args.isSet("-bo") || args.isSet("-vt")) {
+      balls.insert(balls.end(),
+                   std::make_move_iterator(batchBalls.begin()),
+                   std::make_move_iterator(batchBalls.end()));
+    }
+  }
+  std::vector<osm_input::OsmPoi>().swap(pois);
+  success = outComplete.finishCompleteFile() && success;
+  if (!success) {
+    std::cerr << "Writing " << outputpath << " failed." << std::endl;
+    return 1;
+  }
+
+  if (args.isSet("-lc")) {
+    const label_helper::LabelCache* cache = labelHelper.getLabelCache();
+    std::printf("Label cache: %lu hits, %lu misses.\n",
+                cache->getHits(),
+                cache->getMisses());
+    if (!labelHelper.saveLabelCache(args.getValue<std::string>("-lc"))) {
+      std::printf("Could not write the label cache to %s\n",
+                  args.getValue<std::string>("-lc").c_str());
+    }
   }
 
   std::cout << "... successfull!" << std::endl;
 
-  std::cout << "Exporting data ..." << std::endl;
+  // the atlas contains the characters of all labels
+  if (args.isSet("-fa")) {
+    std::cout << "Writing font atlas to files ... " << std::endl;
 
-  std::string outputpath = config.get_labeling_name() + ".complete.txt";
-  std::replace(outputpath.begin(), outputpath.end(), ' ', '_');
-  std::printf("Outputting data to %s\n", outputpath.c_str());
-  text_output::TextOutputHelper outComplete(outputpath);
-  outComplete.writeCompleteFile(balls, ' ', args.isSet("-eh"));
+    labelHelper.outputFontAtlas(config.get_font_name(), args.isSet("-pa"));
 
-  std::cout << "... successfull!" << std::endl;
+    std::cout << "... successfull!" << std::endl;
+  }
+
+  if (args.isSet("-ho")) {
+    std::string orderpath =
+      config.get_labeling_name() + ".hilbert.txt" + compressExt;
+    std::replace(orderpath.begin(), orderpath.end(), ' ', '_');
+    std::printf("Outputting the Hilbert order to %s\n", orderpath.c_str());
+    text_output::TextOutputHelper outOrder(orderpath, threadCount);
+    if (!outOrder.writePermutationFile(
+          poi_ordering::computeHilbertOrder(positions, threadCount))) {
+      std::printf("Could not write the Hilbert order %s\n", orderpath.c_str());
+    }
+  }
+
+  if (args.isSet("-bo")) {
+    std::string binarypath =
+      config.get_labeling_name() + ".balls.bin" + compressExt;
+    std::replace(binarypath.begin(), binarypath.end(), ' ', '_');
+    std::printf("Outputting binary data to %s\n", binarypath.c_str());
+    text_output::TextOutputHelper outBinary(binarypath, threadCount);
+    if (!outBinary.writeBinaryFile(balls)) {
+      std::printf("Could not write the binary file %s\n", binarypath.c_str());
+    }
+  }
+
+  if (args.isSet("-vt")) {
+    std::string tilepath = args.getValue<std::string>("-vt");
+    int minZoom = (args.isSet("-vmin")) ? args.getValue<int>("-vmin") : 0;
+    int maxZoom = (args.isSet("-vmax")) ? args.getValue<int>("-vmax") : 14;
+    std::printf("Outputting vector tiles of the zooms %d to %d to %s\n",
+                minZoom,
+                maxZoom,
+                tilepath.c_str());
+    try {
+      vector_tiles::TileExporter tiles(minZoom, maxZoom, threadCount);
+      if (!tiles.write(tilepath, config.get_labeling_name(), balls)) {
+        std::printf("Not all tiles could be written to %s\n",
+                    tilepath.c_str());
+      }
+      std::printf("Wrote %lu tiles.\n", tiles.getTileCount());
+    } catch (const std::exception& e) {
+      std::cerr << "Exporting the vector tiles failed: " << e.what()
+                << std::endl;
+      return 1;
+    }
+  }
 
   return EXIT_SUCCESS;
 }
@@ -22,8 +22,12 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <map>
+
+#include "osmpoi.h"
 
 typedef mapping_helper::MappingHelper::Constraint Constraint;
 typedef mapping_helper::MappingHelper::Level Level;
@@ -74,7 +78,46 @@ mapping_helper::MappingHelper::Constraint::toString() const
   return result;
 }
 
+// Profile
+const uint64_t mapping_helper::MappingHelper::Profile::SAMPLE_RATE;
+
+mapping_helper::MappingHelper::Profile::Profile()
+  : mEvaluationCounter(0){};
+
+mapping_helper::MappingHelper::Profile::Profile(std::size_t aNodeCount,
+                                                std::size_t aConstraintCount)
+  : mNodeVisits(aNodeCount, 0)
+  , mNodeMatches(aNodeCount, 0)
+  , mConstraintEvaluations(aConstraintCount, 0)
+  , mConstraintMatches(aConstraintCount, 0)
+  , mConstraintSamples(aConstraintCount, 0)
+  , mConstraintSampledNs(aConstraintCount, 0.)
+  , mEvaluationCounter(0){};
+
+void
+mapping_helper::MappingHelper::Profile::merge(const Profile& aOther)
+{
+  assert(mNodeVisits.size() == aOther.mNodeVisits.size());
+  assert(mConstraintEvaluations.size() == aOther.mConstraintEvaluations.size());
+
+  for (std::size_t i = 0; i < mNodeVisits.size(); ++i) {
+    mNodeVisits[i] += aOther.mNodeVisits[i];
+    mNodeMatches[i] += aOther.mNodeMatches[i];
+  }
+  for (std::size_t i = 0; i < mConstraintEvaluations.size(); ++i) {
+    mConstraintEvaluations[i] += aOther.mConstraintEvaluations[i];
+    mConstraintMatches[i] += aOther.mConstraintMatches[i];
+    mConstraintSamples[i] += aOther.mConstraintSamples[i];
+    mConstraintSampledNs[i] += aOther.mConstraintSampledNs[i];
+  }
+  mEvaluationCounter += aOther.mEvaluationCounter;
+}
+
+// end Profile
+
 // Level
+const uint64_t mapping_helper::MappingHelper::Level::UNDEFINED_ID;
+
 mapping_helper::MappingHelper::Level::Level()
   : mName("Undefined Level")
   , mLevelId(Level::UNDEFINED_ID)
@@ -248,6 +291,200 @@ mapping_helper::MappingHelper::LevelTree::computeLevelList(
   }
 }
 
+void
+mapping_helper::MappingHelper::LevelTree::assignNumericSlots(
+  std::vector<std::string>& aNumericKeys)
+{
+  for (auto& c : mConstraints) {
+    if (c.mType != Constraint::ConstraintType::GREATER &&
+        c.mType != Constraint::ConstraintType::LESS) {
+      continue;
+    }
+
+    auto it = std::find(aNumericKeys.begin(), aNumericKeys.end(), c.mTag);
+    c.mNumericSlot = (std::size_t)(it - aNumericKeys.begin());
+    if (it == aNumericKeys.end()) {
+      aNumericKeys.push_back(c.mTag);
+    }
+  }
+
+  for (auto& child : mChildren) {
+    child.assignNumericSlots(aNumericKeys);
+  }
+}
+
+void
+mapping_helper::MappingHelper::LevelTree::assignProfileIndices(
+  std::size_t& aNodeIdx,
+  std::size_t& aConstraintIdx)
+{
+  mProfileIndex = aNodeIdx++;
+  for (auto& c : mConstraints) {
+    c.mProfileIndex = aConstraintIdx++;
+  }
+
+  for (auto& child : mChildren) {
+    child.assignProfileIndices(aNodeIdx, aConstraintIdx);
+  }
+}
+
+void
+mapping_helper::MappingHelper::LevelTree::describeProfile(
+  const Profile& aProfile,
+  std::size_t aDepth,
+  Json::Value& aNodes) const
+{
+  Json::Value node;
+  node["index"] = (Json::UInt64)mProfileIndex;
+  node["name"] = mName;
+  node["depth"] = (Json::UInt64)aDepth;
+  node["leaf"] = mIsLeaf;
+  if (mIsLeaf) {
+    node["level_id"] = (Json::UInt64)mNodeId;
+  }
+  node["visits"] = (Json::UInt64)aProfile.mNodeVisits[mProfileIndex];
+  node["matches"] = (Json::UInt64)aProfile.mNodeMatches[mProfileIndex];
+
+  Json::Value constraints = Json::arrayValue;
+  for (const auto& c : mConstraints) {
+    std::size_t idx = c.mProfileIndex;
+    uint64_t samples = aProfile.mConstraintSamples[idx];
+    double meanNs =
+      (samples > 0) ? aProfile.mConstraintSampledNs[idx] / (double)samples : 0.;
+
+    Json::Value constraint;
+    constraint["index"] = (Json::UInt64)idx;
+    constraint["constraint"] = c.toString();
+    constraint["evaluations"] =
+      (Json::UInt64)aProfile.mConstraintEvaluations[idx];
+    constraint["matches"] = (Json::UInt64)aProfile.mConstraintMatches[idx];
+    constraint["samples"] = (Json::UInt64)samples;
+    constraint["mean_ns"] = meanNs;
+    constraint["estimated_total_ms"] =
+      meanNs * (double)aProfile.mConstraintEvaluations[idx] / 1e6;
+    constraints.append(constraint);
+  }
+  node["constraints"] = constraints;
+
+  aNodes.append(node);
+
+  for (const auto& child : mChildren) {
+    child.describeProfile(aProfile, aDepth + 1, aNodes);
+  }
+}
+
+namespace {
+// a null filter accepts everything
+Json::Value
+combineFilters(const std::string& aType, const std::vector<Json::Value>& aOps)
+{
+  Json::Value operands = Json::arrayValue;
+  // alternatives on the same key are merged into a single value set
+  std::map<std::string, Json::ArrayIndex> valueSets;
+  for (const auto& op : aOps) {
+    if (op.isNull()) {
+      if (aType == "or") {
+        return Json::Value();
+      }
+      continue;
+    }
+
+    std::string type = op["type"].asString();
+    if (aType != "or" || (type != "equals" && type != "values")) {
+      operands.append(op);
+      continue;
+    }
+
+    std::string key = op["key"].asString();
+    auto it = valueSets.find(key);
+    if (it == valueSets.end()) {
+      valueSets.emplace(key, operands.size());
+      operands.append(op);
+      continue;
+    }
+
+    Json::Value& set = operands[it->second];
+    if (set["type"].asString() == "equals") {
+      Json::Value values = Json::arrayValue;
+      values.append(set["value"]);
+      set.removeMember("value");
+      set["type"] = "values";
+      set["values"] = values;
+    }
+    if (type == "equals") {
+      set["values"].append(op["value"]);
+    } else {
+      for (const auto& v : op["values"]) {
+        set["values"].append(v);
+      }
+    }
+  }
+
+  if (operands.size() == 0) {
+    return Json::Value();
+  } else if (operands.size() == 1) {
+    return operands[0];
+  }
+
+  Json::Value result;
+  result["type"] = aType;
+  result["operands"] = operands;
+  return result;
+}
+
+Json::Value
+deriveConstraintFilter(const mapping_helper::MappingHelper::Constraint& aC)
+{
+  typedef mapping_helper::MappingHelper::Constraint::ConstraintType Type;
+
+  Json::Value result;
+  switch (aC.mType) {
+    case Type::EQUALS:
+      result["type"] = "equals";
+      result["key"] = aC.mTag;
+      result["value"] = aC.mStringComp;
+      break;
+    case Type::GREATER:
+    case Type::LESS:
+    case Type::TAG:
+      // numeric comparisons can't be expressed as osmpbf filter
+      result["type"] = "value";
+      result["value"] = aC.mTag;
+      break;
+    default:
+      break;
+  }
+
+  return result;
+}
+} // namespace
+
+Json::Value
+mapping_helper::MappingHelper::LevelTree::deriveFilter() const
+{
+  // a node matches if it has no constraints or any of them holds ...
+  std::vector<Json::Value> constraintFilters;
+  for (const auto& c : mConstraints) {
+    constraintFilters.push_back(deriveConstraintFilter(c));
+  }
+  Json::Value nodeFilter = combineFilters("or", constraintFilters);
+  if (mIsLeaf) {
+    return nodeFilter;
+  }
+
+  // ... and for inner nodes one of the subtrees has to match as well
+  std::vector<Json::Value> childFilters;
+  for (const auto& child : mChildren) {
+    childFilters.push_back(child.deriveFilter());
+  }
+
+  std::vector<Json::Value> operands;
+  operands.push_back(nodeFilter);
+  operands.push_back(combineFilters("or", childFilters));
+
+  return combineFilters("and", operands);
+}
+
 std::size_t
 mapping_helper::MappingHelper::LevelTree::computeTreeSize() const
 {
@@ -298,7 +535,11 @@ mapping_helper::MappingHelper::MappingHelper()
   , mLevelTree(nullptr)
   , mDefaultLevel(new Level())
   , m_required_tag_keys()
-{}
+{
+  initNumericSlots();
+  initLevelIndex();
+  initProfileIndices();
+}
 
 mapping_helper::MappingHelper::MappingHelper(std::string& aInputPath)
   : mDefaultLevel(new Level())
@@ -319,9 +560,9 @@ mapping_helper::MappingHelper::MappingHelper(std::string& aInputPath)
   mLevelTree = new LevelTree(nullptr, root, std::vector<Constraint>(), id);
 
   mCountLevels = mLevelTree->computeTreeSize();
-
-  std::vector<const Level*> lvls;
-  mLevelTree->computeLevelList(lvls);
+  initNumericSlots();
+  initLevelIndex();
+  initProfileIndices();
 }
 
 mapping_helper::MappingHelper::MappingHelper(const Json::Value& aMapping)
@@ -332,9 +573,9 @@ mapping_helper::MappingHelper::MappingHelper(const Json::Value& aMapping)
   mLevelTree = new LevelTree(nullptr, aMapping, std::vector<Constraint>(), id);
 
   mCountLevels = mLevelTree->computeTreeSize();
-
-  std::vector<const Level*> lvls;
-  mLevelTree->computeLevelList(lvls);
+  initNumericSlots();
+  initLevelIndex();
+  initProfileIndices();
 }
 
 mapping_helper::MappingHelper::MappingHelper(
@@ -342,7 +583,11 @@ mapping_helper::MappingHelper::MappingHelper(
   : mCountLevels(aOther.mCountLevels)
   , mLevelTree(std::move(aOther.mLevelTree))
   , mDefaultLevel(std::move(aOther.mDefaultLevel))
-  , m_required_tag_keys(aOther.m_required_tag_keys){};
+  , mLevelsById(std::move(aOther.mLevelsById))
+  , mProfileNodeCount(aOther.mProfileNodeCount)
+  , mProfileConstraintCount(aOther.mProfileConstraintCount)
+  , m_required_tag_keys(aOther.m_required_tag_keys)
+  , m_numeric_tag_keys(aOther.m_numeric_tag_keys){};
 
 mapping_helper::MappingHelper&
 mapping_helper::MappingHelper::operator=(mapping_helper::MappingHelper&& aOther)
@@ -350,10 +595,55 @@ mapping_helper::MappingHelper::operator=(mapping_helper::MappingHelper&& aOther)
   mCountLevels = aOther.mCountLevels;
   mLevelTree = std::move(aOther.mLevelTree);
   mDefaultLevel = std::move(aOther.mDefaultLevel);
+  mLevelsById = std::move(aOther.mLevelsById);
+  mProfileNodeCount = aOther.mProfileNodeCount;
+  mProfileConstraintCount = aOther.mProfileConstraintCount;
+  m_numeric_tag_keys = std::move(aOther.m_numeric_tag_keys);
 
   return *this;
 }
 
+void
+mapping_helper::MappingHelper::initProfileIndices()
+{
+  mProfileNodeCount = 0;
+  mProfileConstraintCount = 0;
+
+  if (mLevelTree != nullptr) {
+    mLevelTree->assignProfileIndices(mProfileNodeCount,
+                                     mProfileConstraintCount);
+  }
+}
+
+void
+mapping_helper::MappingHelper::initLevelIndex()
+{
+  mLevelsById.clear();
+  mLevelsById.push_back(mDefaultLevel);
+  if (mLevelTree == nullptr) {
+    return;
+  }
+
+  for (const Level* lvl : getLevels()) {
+    if (lvl->mLevelId >= mLevelsById.size()) {
+      mLevelsById.resize(lvl->mLevelId + 1, mDefaultLevel);
+    }
+    mLevelsById[lvl->mLevelId] = lvl;
+  }
+}
+
+void
+mapping_helper::MappingHelper::initNumericSlots()
+{
+  m_numeric_tag_keys.clear();
+  // the ranking key always occupies RANKING_TAG_SLOT
+  m_numeric_tag_keys.push_back("population");
+
+  if (mLevelTree != nullptr) {
+    mLevelTree->assignNumericSlots(m_numeric_tag_keys);
+  }
+}
+
 namespace {
 
 typedef mapping_helper::MappingHelper::Constraint Constraint;
@@ -361,25 +651,40 @@ typedef mapping_helper::MappingHelper::Constraint::ConstraintType
   ConstraintType;
 typedef mapping_helper::MappingHelper::Level Level;
 
-std::string
+const std::string*
 getTagValue(const std::vector<osm_input::Tag>& aTags,
             const std::string& aTagName)
 {
   for (auto& tag : aTags) {
     if (tag.mKey == aTagName) {
-      return tag.mValue;
+      return &tag.mValue;
     }
   }
 
-  return "<undefined>";
+  return nullptr;
 }
 
 bool
 checkConstraint(const Constraint& aConstraint,
-                const std::vector<osm_input::Tag>& aTags)
+                const std::vector<osm_input::Tag>& aTags,
+                const osm_input::NumericTags& aNumericTags)
 {
-  std::string tagValue = getTagValue(aTags, aConstraint.mTag);
-  if (tagValue == "<undefined>") {
+  // numeric constraints only read the pre-parsed values
+  switch (aConstraint.mType) {
+    case ConstraintType::GREATER:
+      return aNumericTags.isDefined(aConstraint.mNumericSlot) &&
+             aConstraint.mNumericComp <=
+               aNumericTags.get(aConstraint.mNumericSlot);
+    case ConstraintType::LESS:
+      return aNumericTags.isDefined(aConstraint.mNumericSlot) &&
+             aConstraint.mNumericComp >
+               aNumericTags.get(aConstraint.mNumericSlot);
+    default:
+      break;
+  }
+
+  const std::string* tagValue = getTagValue(aTags, aConstraint.mTag);
+  if (tagValue == nullptr) {
     return false;
   }
 
@@ -387,54 +692,85 @@ checkConstraint(const Constraint& aConstraint,
 
   switch (aConstraint.mType) {
     case ConstraintType::EQUALS:
-      result = (aConstraint.mStringComp == tagValue);
-      break;
-    case ConstraintType::GREATER:
-      result = (aConstraint.mNumericComp <= std::atoi(tagValue.c_str()));
-      break;
-    case ConstraintType::LESS:
-      result = (aConstraint.mNumericComp > std::atoi(tagValue.c_str()));
+      result = (aConstraint.mStringComp == *tagValue);
       break;
     case ConstraintType::TAG:
-      result = (tagValue != "<undefined>");
+      result = true;
       break;
     case ConstraintType::DEFAULT:
       result = true;
       break;
+    default:
+      break;
   }
 
   return result;
 }
 
 bool
-checkConstraints(const Level& aLevel, const std::vector<osm_input::Tag>& aTags)
+checkConstraint(const Constraint& aConstraint,
+                const std::vector<osm_input::Tag>& aTags,
+                const osm_input::NumericTags& aNumericTags,
+                mapping_helper::MappingHelper::Profile* aProfile)
 {
-  for (const auto& c : aLevel.mConstraints) {
-    if (!checkConstraint(c, aTags))
-      return false;
+  typedef mapping_helper::MappingHelper::Profile Profile;
+
+  if (aProfile == nullptr) {
+    return checkConstraint(aConstraint, aTags, aNumericTags);
   }
 
-  return true;
+  std::size_t idx = aConstraint.mProfileIndex;
+  ++aProfile->mConstraintEvaluations[idx];
+
+  bool result;
+  if (++aProfile->mEvaluationCounter % Profile::SAMPLE_RATE == 0) {
+    auto start = std::chrono::steady_clock::now();
+    result = checkConstraint(aConstraint, aTags, aNumericTags);
+    auto end = std::chrono::steady_clock::now();
+
+    ++aProfile->mConstraintSamples[idx];
+    aProfile->mConstraintSampledNs[idx] +=
+      std::chrono::duration<double, std::nano>(end - start).count();
+  } else {
+    result = checkConstraint(aConstraint, aTags, aNumericTags);
+  }
+
+  if (result) {
+    ++aProfile->mConstraintMatches[idx];
+  }
+
+  return result;
 }
 } // namespace
 
 const Level*
 mapping_helper::MappingHelper::LevelTree::computeLevel(
   const std::vector<osm_input::Tag>& aTags,
-  const Level* aDefault) const
+  const osm_input::NumericTags& aNumericTags,
+  const Level* aDefault,
+  Profile* aProfile) const
 {
+  if (aProfile != nullptr) {
+    ++aProfile->mNodeVisits[mProfileIndex];
+  }
+
   bool matches = (mConstraints.size() == 0);
   for (const auto& c : mConstraints) {
-    matches = matches || checkConstraint(c, aTags);
+    matches = matches || checkConstraint(c, aTags, aNumericTags, aProfile);
   }
   if (!matches)
     return aDefault;
 
+  if (aProfile != nullptr) {
+    ++aProfile->mNodeMatches[mProfileIndex];
+  }
+
   if (mIsLeaf) {
     return mLevel;
   } else {
     for (const auto& subtree : mChildren) {
-      auto level = subtree.computeLevel(aTags, aDefault);
+      auto level =
+        subtree.computeLevel(aTags, aNumericTags, aDefault, aProfile);
       if (level->mLevelId != aDefault->mLevelId) {
         return level;
       }
@@ -448,11 +784,82 @@ const Level*
 mapping_helper::MappingHelper::computeLevel(
   const std::vector<osm_input::Tag>& aTags) const
 {
-  auto* level = mLevelTree->computeLevel(aTags, mDefaultLevel);
+  return computeLevel(aTags, parseNumericTags(aTags));
+}
+
+const Level*
+mapping_helper::MappingHelper::computeLevel(
+  const std::vector<osm_input::Tag>& aTags,
+  const osm_input::NumericTags& aNumericTags,
+  Profile* aProfile) const
+{
+  auto* level =
+    mLevelTree->computeLevel(aTags, aNumericTags, mDefaultLevel, aProfile);
 
   return level;
 }
 
+std::vector<uint64_t>
+mapping_helper::MappingHelper::computeLevelIds(
+  const std::vector<osm_input::Tag>* aTagSets,
+  std::size_t aCount,
+  int32_t aThreadCount,
+  Profile* aProfile,
+  std::vector<osm_input::NumericTags>* aNumericTags) const
+{
+  std::vector<uint64_t> result(aCount, Level::UNDEFINED_ID);
+  if (aNumericTags != nullptr) {
+    aNumericTags->assign(aCount, osm_input::NumericTags());
+  }
+
+#pragma omp parallel num_threads(aThreadCount)
+  {
+    Profile localProfile;
+    if (aProfile != nullptr) {
+      localProfile = createProfile();
+    }
+    Profile* profile = (aProfile != nullptr) ? &localProfile : nullptr;
+
+#pragma omp for schedule(dynamic, 4096)
+    for (int64_t i = 0; i < (int64_t)aCount; ++i) {
+      const auto& tags = aTagSets[i];
+      osm_input::NumericTags numericTags = parseNumericTags(tags);
+      result[i] = computeLevel(tags, numericTags, profile)->mLevelId;
+      if (aNumericTags != nullptr) {
+        (*aNumericTags)[i] = std::move(numericTags);
+      }
+    }
+
+    if (aProfile != nullptr) {
+#pragma omp critical
+      aProfile->merge(localProfile);
+    }
+  }
+
+  return result;
+}
+
+osm_input::NumericTags
+mapping_helper::MappingHelper::parseNumericTags(
+  const std::vector<osm_input::Tag>& aTags) const
+{
+  osm_input::NumericTags result(m_numeric_tag_keys.size());
+
+  for (const auto& tag : aTags) {
+    for (std::size_t slot = 0; slot < m_numeric_tag_keys.size(); ++slot) {
+      if (tag.mKey != m_numeric_tag_keys[slot] || result.isDefined(slot)) {
+        continue;
+      }
+
+      int64_t value;
+      osm_input::NumericTags::parseValue(tag.mValue, value);
+      result.set(slot, value);
+    }
+  }
+
+  return result;
+}
+
 std::vector<const Level*>
 mapping_helper::MappingHelper::getLevels() const
 {
@@ -464,18 +871,132 @@ mapping_helper::MappingHelper::getLevels() const
   return result;
 }
 
+const mapping_helper::MappingHelper::Level*
+mapping_helper::MappingHelper::getLevel(uint64_t aLevelId) const
+{
+  if (aLevelId >= mLevelsById.size()) {
+    return mDefaultLevel;
+  }
+
+  return mLevelsById[aLevelId];
+}
+
 const mapping_helper::MappingHelper::Level*
 mapping_helper::MappingHelper::getLevelDefault() const
 {
   return mDefaultLevel;
 }
 
+mapping_helper::MappingHelper::Profile
+mapping_helper::MappingHelper::createProfile() const
+{
+  return Profile(mProfileNodeCount, mProfileConstraintCount);
+}
+
+namespace {
+std::string
+toCsvField(const std::string& aValue)
+{
+  std::string result = "\"";
+  for (char c : aValue) {
+    if (c == '"') {
+      result += '"';
+    }
+    result += c;
+  }
+  return result + "\"";
+}
+} // namespace
+
+bool
+mapping_helper::MappingHelper::writeProfileReport(
+  const Profile& aProfile,
+  const std::string& aBasePath) const
+{
+  if (mLevelTree == nullptr ||
+      aProfile.mNodeVisits.size() != mProfileNodeCount) {
+    return false;
+  }
+
+  Json::Value nodes = Json::arrayValue;
+  mLevelTree->describeProfile(aProfile, 0, nodes);
+
+  Json::Value root;
+  root["sample_rate"] = (Json::UInt64)Profile::SAMPLE_RATE;
+  root["constraint_evaluations"] = (Json::UInt64)aProfile.mEvaluationCounter;
+  root["nodes"] = nodes;
+
+  std::ofstream json(aBasePath + ".profile.json");
+  if (!json.is_open()) {
+    return false;
+  }
+  Json::StyledWriter jsonWriter;
+  json << jsonWriter.write(root);
+  json.close();
+
+  std::ofstream csv(aBasePath + ".profile.csv");
+  if (!csv.is_open()) {
+    return false;
+  }
+  csv << "node,depth,name,leaf,visits,node_matches,constraint,evaluations,"
+         "matches,mean_ns,estimated_total_ms\n";
+  for (const auto& node : nodes) {
+    std::string prefix =
+      node["index"].asString() + "," + node["depth"].asString() + "," +
+      toCsvField(node["name"].asString()) + "," +
+      (node["leaf"].asBool() ? "1" : "0") + "," + node["visits"].asString() +
+      "," + node["matches"].asString() + ",";
+
+    if (node["constraints"].size() == 0) {
+      csv << prefix << ",,,,\n";
+    }
+    for (const auto& c : node["constraints"]) {
+      csv << prefix << toCsvField(c["constraint"].asString()) << ","
+          << c["evaluations"].asString() << "," << c["matches"].asString()
+          << "," << c["mean_ns"].asDouble() << ","
+          << c["estimated_total_ms"].asDouble() << "\n";
+    }
+  }
+  csv.close();
+
+  return true;
+}
+
 const std::unordered_set<std::string>&
 mapping_helper::MappingHelper::get_tag_key_set() const
 {
   return m_required_tag_keys;
 }
 
+const std::vector<std::string>&
+mapping_helper::MappingHelper::get_numeric_tag_keys() const
+{
+  return m_numeric_tag_keys;
+}
+
+std::size_t
+mapping_helper::MappingHelper::requireNumericTag(const std::string& aKey)
+{
+  auto it =
+    std::find(m_numeric_tag_keys.begin(), m_numeric_tag_keys.end(), aKey);
+  if (it != m_numeric_tag_keys.end()) {
+    return (std::size_t)(it - m_numeric_tag_keys.begin());
+  }
+
+  m_numeric_tag_keys.push_back(aKey);
+  return m_numeric_tag_keys.size() - 1;
+}
+
+Json::Value
+mapping_helper::MappingHelper::deriveFilter() const
+{
+  if (mLevelTree == nullptr) {
+    return Json::Value();
+  }
+
+  return mLevelTree->deriveFilter();
+}
+
 void
 mapping_helper::MappingHelper::test()
 {
@@ -29,8 +29,13 @@
 #include <vector>
 
 #include <json/json.h>
+#include "numerictags.h"
 #include "tag.h"
 
+namespace osm_input {
+class OsmPoi;
+}
+
 namespace mapping_helper {
 class MappingHelper
 {
@@ -46,10 +51,17 @@ public:
       TAG
     };
 
+    static const std::size_t NO_NUMERIC_SLOT =
+      std::numeric_limits<std::size_t>::max();
+
     ConstraintType mType;
     std::string mTag;
     int32_t mNumericComp = 0;
     std::string mStringComp = "";
+    // slot of mTag in the poi's NumericTags (GREATER and LESS only)
+    std::size_t mNumericSlot = NO_NUMERIC_SLOT;
+    // index of the constraint in a Profile
+    std::size_t mProfileIndex = 0;
 
     Constraint(const Json::Value& aJson);
 
@@ -89,7 +101,37 @@ public:
     bool operator>=(const Level& aOther) const;
   };
 
+  /**
+   * Per rule statistics collected by computeLevel if a profile is passed.
+   * Profiles are not thread safe: use one per thread and merge them.
+   */
+  struct Profile
+  {
+    // evaluate the time of every SAMPLE_RATE-th constraint evaluation
+    static const uint64_t SAMPLE_RATE = 64;
+
+    // per LevelTree node
+    std::vector<uint64_t> mNodeVisits;
+    std::vector<uint64_t> mNodeMatches;
+
+    // per constraint
+    std::vector<uint64_t> mConstraintEvaluations;
+    std::vector<uint64_t> mConstraintMatches;
+    std::vector<uint64_t> mConstraintSamples;
+    std::vector<double> mConstraintSampledNs;
+
+    uint64_t mEvaluationCounter;
+
+    Profile();
+    Profile(std::size_t aNodeCount, std::size_t aConstraintCount);
+
+    void merge(const Profile& aOther);
+  };
+
 public:
+  // the tag used to rank pois of the same level, always numeric slot 0
+  static const std::size_t RANKING_TAG_SLOT = 0;
+
   MappingHelper();
   MappingHelper(std::string& aInputPath);
   MappingHelper(const Json::Value& aMapping);
@@ -99,11 +141,54 @@ public:
   MappingHelper& operator=(MappingHelper&& aOther);
 
   const Level* computeLevel(const std::vector<osm_input::Tag>& aTags) const;
+  const Level* computeLevel(const std::vector<osm_input::Tag>& aTags,
+                            const osm_input::NumericTags& aNumericTags,
+                            Profile* aProfile = nullptr) const;
+
+  osm_input::NumericTags parseNumericTags(
+    const std::vector<osm_input::Tag>& aTags) const;
+
+  /**
+   * Batch classification: compute the level id of aCount tag sets using
+   * aThreadCount threads. Numeric tags are parsed with the slots of this
+   * mapping, so pois imported with a different config are classified
+   * correctly. If aNumericTags is given it receives the parsed numeric tags
+   * of every tag set.
+   */
+  std::vector<uint64_t> computeLevelIds(
+    const std::vector<osm_input::Tag>* aTagSets,
+    std::size_t aCount,
+    int32_t aThreadCount,
+    Profile* aProfile = nullptr,
+    std::vector<osm_input::NumericTags>* aNumericTags = nullptr) const;
 
   std::vector<const Level*> getLevels() const;
+  const Level* getLevel(uint64_t aLevelId) const;
   const Level* getLevelDefault() const;
 
+  // an empty profile sized for this mapping
+  Profile createProfile() const;
+  /**
+   * Write the profile as <aBasePath>.profile.json and <aBasePath>.profile.csv
+   */
+  bool writeProfileReport(const Profile& aProfile,
+                          const std::string& aBasePath) const;
+
   const std::unordered_set<std::string>& get_tag_key_set() const;
+  const std::vector<std::string>& get_numeric_tag_keys() const;
+  /**
+   * Slot of the numeric tag aKey, the tag is parsed into a new slot if the
+   * mapping does not compare it numerically yet. Has to be called before
+   * any poi is classified.
+   */
+  std::size_t requireNumericTag(const std::string& aKey);
+
+  /**
+   * Derive the tightest osmpbf tag filter accepting every tag set that can be
+   * mapped to a defined level. The result uses the json format of the config
+   * filter block and is null if the mapping accepts every element.
+   */
+  Json::Value deriveFilter() const;
 
   void test();
 
@@ -117,7 +202,18 @@ private:
               uint32_t& aNodeId);
 
     const Level* computeLevel(const std::vector<osm_input::Tag>& aTags,
-                              const Level* aDefault) const;
+                              const osm_input::NumericTags& aNumericTags,
+                              const Level* aDefault,
+                              Profile* aProfile) const;
+
+    void assignNumericSlots(std::vector<std::string>& aNumericKeys);
+    void assignProfileIndices(std::size_t& aNodeIdx,
+                              std::size_t& aConstraintIdx);
+    void describeProfile(const Profile& aProfile,
+                         std::size_t aDepth,
+                         Json::Value& aNodes) const;
+
+    Json::Value deriveFilter() const;
 
     void computeLevelList(std::vector<const Level*>& aLevels) const;
     std::size_t computeTreeSize() const;
@@ -132,13 +228,23 @@ private:
     bool mIsLeaf;
     std::string mName;
     uint64_t mNodeId;
+    std::size_t mProfileIndex;
     std::vector<Constraint> mConstraints;
   };
 
+  void initNumericSlots();
+  void initLevelIndex();
+  void initProfileIndices();
+
   std::size_t mCountLevels;
   LevelTree* mLevelTree;
   const Level* mDefaultLevel;
+  // leaf levels indexed by their level id
+  std::vector<const Level*> mLevelsById;
+  std::size_t mProfileNodeCount;
+  std::size_t mProfileConstraintCount;
   std::unordered_set<std::string> m_required_tag_keys;
+  std::vector<std::string> m_numeric_tag_keys;
 };
 } // namespace mapping_helper
 
@@ -0,0 +1,724 @@
+/*
+ * Compute the importance order of a poi set
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "poiordering.h"
+#include "hilbert.h"
+#include "ranking.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <omp.h>
+
+namespace poiordering {
+// bits used for the ranking value if level id and ranking value share a word
+const int RANKING_BITS = 40;
+const int64_t RANKING_BIAS = int64_t(1) << (RANKING_BITS - 1);
+const uint64_t MAX_PACKED_LEVEL = (uint64_t(1) << (64 - RANKING_BITS)) - 1;
+
+const std::size_t RADIX = 256;
+
+/**
+ * Determine which bytes of the keys actually differ. Returns a bit mask per
+ * word, bit b is set if byte b of the word is not equal for all keys.
+ */
+std::vector<uint8_t>
+computeActiveBytes(const poi_ordering::SortKeys& aKeys, int32_t aThreadCount)
+{
+  std::size_t words = aKeys.mWords;
+  std::vector<uint8_t> result(words, 0);
+  int64_t count = aKeys.size();
+  if (count < 2) {
+    return result;
+  }
+
+  const uint64_t* first = aKeys.get(0);
+  std::vector<uint64_t> diff(words, 0);
+#pragma omp parallel num_threads(aThreadCount)
+  {
+    std::vector<uint64_t> localDiff(words, 0);
+#pragma omp for schedule(static)
+    for (int64_t i = 1; i < count; ++i) {
+      const uint64_t* key = aKeys.get(i);
+      for (std::size_t w = 0; w < words; ++w) {
+        localDiff[w] |= key[w] ^ first[w];
+      }
+    }
+#pragma omp critical
+    for (std::size_t w = 0; w < words; ++w) {
+      diff[w] |= localDiff[w];
+    }
+  }
+
+  for (std::size_t w = 0; w < words; ++w) {
+    for (int b = 0; b < 8; ++b) {
+      if ((diff[w] >> (8 * b)) & 0xFF) {
+        result[w] |= uint8_t(1) << b;
+      }
+    }
+  }
+
+  return result;
+}
+
+/**
+ * One stable scatter pass over records of aStride words sorting by byte
+ * aByte of word aWord.
+ */
+void
+radixPass(const std::vector<uint64_t>& aSource,
+          std::vector<uint64_t>& aTarget,
+          std::size_t aStride,
+          std::size_t aWord,
+          int aByte,
+          int32_t aThreadCount)
+{
+  std::size_t count = aSource.size() / aStride;
+  int shift = 8 * aByte;
+  std::vector<std::size_t> histograms(aThreadCount * RADIX, 0);
+
+#pragma omp parallel num_threads(aThreadCount)
+  {
+    std::size_t threads = omp_get_num_threads();
+    std::size_t thread = omp_get_thread_num();
+    std::size_t begin = count * thread / threads;
+    std::size_t end = count * (thread + 1) / threads;
+    std::size_t* hist = histograms.data() + thread * RADIX;
+
+    const uint64_t* src = aSource.data();
+    for (std::size_t i = begin; i < end; ++i) {
+      ++hist[(src[i * aStride + aWord] >> shift) & 0xFF];
+    }
+
+#pragma omp barrier
+#pragma omp single
+    {
+      // digit major, thread minor to keep the pass stable
+      std::size_t offset = 0;
+      for (std::size_t d = 0; d < RADIX; ++d) {
+        for (std::size_t t = 0; t < threads; ++t) {
+          std::size_t c = histograms[t * RADIX + d];
+          histograms[t * RADIX + d] = offset;
+          offset += c;
+        }
+      }
+    }
+
+    uint64_t* dst = aTarget.data();
+    for (std::size_t i = begin; i < end; ++i) {
+      const uint64_t* record = src + i * aStride;
+      std::size_t pos = hist[(record[aWord] >> shift) & 0xFF]++;
+      std::copy(record, record + aStride, dst + pos * aStride);
+    }
+  }
+}
+
+bool
+keyLess(const uint64_t* aFirst, const uint64_t* aSecond, std::size_t aWords)
+{
+  for (std::size_t w = 0; w < aWords; ++w) {
+    if (aFirst[w] != aSecond[w]) {
+      return aFirst[w] < aSecond[w];
+    }
+  }
+
+  return false;
+}
+
+// a contiguous range of records in the flat record array
+struct Run
+{
+  std::size_t mBegin;
+  std::size_t mEnd;
+
+  std::size_t size() const { return mEnd - mBegin; };
+};
+
+/**
+ * Number of records of aRun that are smaller than aRecord. The records end
+ * with their unique original index, so comparing whole records is a strict
+ * total order that keeps equal keys in run order.
+ */
+std::size_t
+countLess(const uint64_t* aRecords,
+          std::size_t aStride,
+          const Run& aRun,
+          const uint64_t* aRecord)
+{
+  std::size_t lo = 0;
+  std::size_t hi = aRun.size();
+  while (lo < hi) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if (keyLess(aRecords + (aRun.mBegin + mid) * aStride, aRecord, aStride)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+/**
+ * Split the runs on the merge path at output rank aRank: aSplit[r] is the
+ * number of records of run r among the aRank smallest records of all runs.
+ */
+void
+splitRuns(const uint64_t* aRecords,
+          std::size_t aStride,
+          const std::vector<Run>& aRuns,
+          std::size_t aRank,
+          std::vector<std::size_t>& aSplit)
+{
+  aSplit.assign(aRuns.size(), 0);
+
+  // the record of rank aRank lies in exactly one run, its global rank grows
+  // with the position in that run
+  for (std::size_t r = 0; r < aRuns.size(); ++r) {
+    std::size_t lo = 0;
+    std::size_t hi = aRuns[r].size();
+    while (lo < hi) {
+      std::size_t mid = lo + (hi - lo) / 2;
+      const uint64_t* record = aRecords + (aRuns[r].mBegin + mid) * aStride;
+      std::size_t rank = mid;
+      for (std::size_t o = 0; o < aRuns.size(); ++o) {
+        if (o != r) {
+          rank += countLess(aRecords, aStride, aRuns[o], record);
+        }
+      }
+
+      if (rank < aRank) {
+        lo = mid + 1;
+      } else if (rank > aRank) {
+        hi = mid;
+      } else {
+        for (std::size_t o = 0; o < aRuns.size(); ++o) {
+          aSplit[o] =
+            (o == r) ? mid : countLess(aRecords, aStride, aRuns[o], record);
+        }
+        return;
+      }
+    }
+  }
+
+  // aRank is the total size
+  for (std::size_t r = 0; r < aRuns.size(); ++r) {
+    aSplit[r] = aRuns[r].size();
+  }
+}
+
+// next record and end of the unmerged part of a run
+struct RunHead
+{
+  const uint64_t* mNext;
+  const uint64_t* mEnd;
+};
+
+// inverted order, the heap yields the smallest record first
+struct RunHeadGreater
+{
+  std::size_t mStride;
+
+  bool operator()(const RunHead& aFirst, const RunHead& aSecond) const
+  {
+    return keyLess(aSecond.mNext, aFirst.mNext, mStride);
+  };
+};
+
+/**
+ * k-way merge of the parts [aBegin[r], aEnd[r]) of the runs into aTarget
+ * starting at record aTargetBegin.
+ */
+void
+mergeChunk(const std::vector<uint64_t>& aSource,
+           std::vector<uint64_t>& aTarget,
+           std::size_t aStride,
+           const std::vector<Run>& aRuns,
+           const std::vector<std::size_t>& aBegin,
+           const std::vector<std::size_t>& aEnd,
+           std::size_t aTargetBegin)
+{
+  const uint64_t* src = aSource.data();
+  std::vector<RunHead> heads;
+  for (std::size_t r = 0; r < aRuns.size(); ++r) {
+    if (aBegin[r] < aEnd[r]) {
+      heads.push_back({ src + (aRuns[r].mBegin + aBegin[r]) * aStride,
+                        src + (aRuns[r].mBegin + aEnd[r]) * aStride });
+    }
+  }
+
+  RunHeadGreater greater = { aStride };
+  std::make_heap(heads.begin(), heads.end(), greater);
+  uint64_t* dst = aTarget.data() + aTargetBegin * aStride;
+  while (!heads.empty()) {
+    std::pop_heap(heads.begin(), heads.end(), greater);
+    RunHead& head = heads.back();
+    std::copy(head.mNext, head.mNext + aStride, dst);
+    dst += aStride;
+    head.mNext += aStride;
+    if (head.mNext == head.mEnd) {
+      heads.pop_back();
+    } else {
+      std::push_heap(heads.begin(), heads.end(), greater);
+    }
+  }
+}
+
+std::vector<uint64_t>
+createRecords(const poi_ordering::SortKeys& aKeys, int32_t aThreadCount)
+{
+  std::size_t count = aKeys.size();
+  if (count > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Poi ordering supports at most 2^32 elements");
+  }
+
+  // records of the key words followed by the original index
+  std::size_t words = aKeys.mWords;
+  std::size_t stride = words + 1;
+  std::vector<uint64_t> records(count * stride);
+#pragma omp parallel for num_threads(aThreadCount) schedule(static)
+  for (int64_t i = 0; i < (int64_t)count; ++i) {
+    const uint64_t* key = aKeys.get(i);
+    std::copy(key, key + words, records.data() + i * stride);
+    records[i * stride + words] = i;
+  }
+
+  return records;
+}
+
+std::vector<uint32_t>
+extractOrder(const std::vector<uint64_t>& aRecords, std::size_t aStride)
+{
+  std::size_t count = aRecords.size() / aStride;
+  std::vector<uint32_t> result(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    result[i] = (uint32_t)aRecords[i * aStride + aStride - 1];
+  }
+
+  return result;
+}
+
+// order of the pois within one level bucket
+struct LevelEntry
+{
+  int64_t mRanking;
+  int64_t mOsmId;
+  uint32_t mIndex;
+
+  bool operator<(const LevelEntry& aOther) const
+  {
+    if (mRanking != aOther.mRanking) {
+      return mRanking < aOther.mRanking;
+    }
+    return mOsmId < aOther.mOsmId;
+  };
+};
+} // namespace poiordering
+
+poi_ordering::SortKeys
+poi_ordering::computeDefaultKeys(const std::vector<osm_input::OsmPoi>& aPois,
+                                 int32_t aThreadCount)
+{
+  int64_t count = aPois.size();
+
+  // check whether level id and ranking value can share a single word
+  bool packed = true;
+#pragma omp parallel for num_threads(aThreadCount) reduction(&& : packed)
+  for (int64_t i = 0; i < count; ++i) {
+    const osm_input::OsmPoi& poi = aPois[i];
+    int64_t ranking = poi.getRankingValue();
+    packed = packed &&
+             poi.getLevel()->mLevelId <= poiordering::MAX_PACKED_LEVEL &&
+             ranking >= -poiordering::RANKING_BIAS &&
+             ranking < poiordering::RANKING_BIAS;
+  }
+
+  SortKeys keys(count, packed ? 2 : 3);
+#pragma omp parallel for num_threads(aThreadCount) schedule(static)
+  for (int64_t i = 0; i < count; ++i) {
+    const osm_input::OsmPoi& poi = aPois[i];
+    uint64_t* key = keys.get(i);
+    uint64_t level = poi.getLevel()->mLevelId;
+    int64_t ranking = poi.getRankingValue();
+    if (packed) {
+      key[0] = (level << poiordering::RANKING_BITS) |
+               uint64_t(ranking + poiordering::RANKING_BIAS);
+      key[1] = toOrderedKey(poi.getOsmId());
+    } else {
+      key[0] = level;
+      key[1] = toOrderedKey(ranking);
+      key[2] = toOrderedKey(poi.getOsmId());
+    }
+  }
+
+  return keys;
+}
+
+std::vector<uint32_t>
+poi_ordering::radixSort(const SortKeys& aKeys, int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+
+  std::size_t words = aKeys.mWords;
+  std::size_t stride = words + 1;
+  std::vector<uint64_t> records =
+    poiordering::createRecords(aKeys, aThreadCount);
+
+  std::vector<uint8_t> active =
+    poiordering::computeActiveBytes(aKeys, aThreadCount);
+  std::vector<uint64_t> buffer(records.size());
+  for (std::size_t w = words; w-- > 0;) {
+    for (int b = 0; b < 8; ++b) {
+      if (active[w] & (uint8_t(1) << b)) {
+        poiordering::radixPass(records, buffer, stride, w, b, aThreadCount);
+        records.swap(buffer);
+      }
+    }
+  }
+
+  return poiordering::extractOrder(records, stride);
+}
+
+std::vector<uint32_t>
+poi_ordering::mergeRuns(const SortKeys& aKeys,
+                        const std::vector<std::size_t>& aRunOffsets,
+                        int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+
+  std::size_t count = aKeys.size();
+  std::size_t stride = aKeys.mWords + 1;
+  std::vector<uint64_t> records =
+    poiordering::createRecords(aKeys, aThreadCount);
+
+  if (count > 0 && (aRunOffsets.empty() || aRunOffsets.front() != 0)) {
+    throw std::runtime_error("The first sorted run has to start at 0");
+  }
+
+  std::vector<poiordering::Run> runs;
+  for (std::size_t i = 0; i < aRunOffsets.size(); ++i) {
+    std::size_t end = (i + 1 < aRunOffsets.size()) ? aRunOffsets[i + 1] : count;
+    if (aRunOffsets[i] < end) {
+      runs.push_back({ aRunOffsets[i], end });
+    }
+  }
+
+  if (runs.size() < 2) {
+    return poiordering::extractOrder(records, stride);
+  }
+
+  // about four equally sized chunks of the output per thread, each merged
+  // from all runs independently
+  std::size_t chunkCount =
+    std::min<std::size_t>(4 * (std::size_t)aThreadCount, count);
+  std::vector<std::vector<std::size_t>> splits(chunkCount + 1);
+#pragma omp parallel for num_threads(aThreadCount) schedule(dynamic, 1)
+  for (int64_t c = 0; c <= (int64_t)chunkCount; ++c) {
+    poiordering::splitRuns(records.data(),
+                           stride,
+                           runs,
+                           count * (std::size_t)c / chunkCount,
+                           splits[c]);
+  }
+
+  std::vector<uint64_t> buffer(records.size());
+#pragma omp parallel for num_threads(aThreadCount) schedule(dynamic, 1)
+  for (int64_t c = 0; c < (int64_t)chunkCount; ++c) {
+    poiordering::mergeChunk(records,
+                            buffer,
+                            stride,
+                            runs,
+                            splits[c],
+                            splits[c + 1],
+                            count * (std::size_t)c / chunkCount);
+  }
+
+  return poiordering::extractOrder(buffer, stride);
+}
+
+void
+poi_ordering::permute(std::vector<osm_input::OsmPoi>& aPois,
+                      const std::vector<uint32_t>& aOrder)
+{
+  std::vector<osm_input::OsmPoi> result;
+  result.reserve(aPois.size());
+  for (uint32_t idx : aOrder) {
+    result.push_back(std::move(aPois[idx]));
+  }
+
+  aPois.swap(result);
+}
+
+void
+poi_ordering::sortPois(std::vector<osm_input::OsmPoi>& aPois,
+                       int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+  SortKeys keys = computeDefaultKeys(aPois, aThreadCount);
+  permute(aPois, radixSort(keys, aThreadCount));
+}
+
+void
+poi_ordering::sortPois(std::vector<osm_input::OsmPoi>& aPois,
+                       const Ranking& aRanking,
+                       int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+  SortKeys keys = aRanking.computeKeys(aPois, aThreadCount);
+  permute(aPois, radixSort(keys, aThreadCount));
+}
+
+std::vector<uint32_t>
+poi_ordering::computeHilbertOrder(
+  const std::vector<osm_input::OsmPoi::Position>& aPositions,
+  int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+
+  double minLat = std::numeric_limits<double>::max();
+  double minLon = std::numeric_limits<double>::max();
+  double maxLat = std::numeric_limits<double>::lowest();
+  double maxLon = std::numeric_limits<double>::lowest();
+  for (const auto& pos : aPositions) {
+    minLat = std::min(minLat, pos.getLatDegree());
+    minLon = std::min(minLon, pos.getLonDegree());
+    maxLat = std::max(maxLat, pos.getLatDegree());
+    maxLon = std::max(maxLon, pos.getLonDegree());
+  }
+
+  SortKeys keys(aPositions.size(), 1);
+#pragma omp parallel for num_threads(aThreadCount)
+  for (int64_t i = 0; i < (int64_t)aPositions.size(); ++i) {
+    const auto& pos = aPositions[i];
+    keys.get(i)[0] = ball_file::hilbertIndex(
+      ball_file::toGridCoordinate(pos.getLonDegree(), minLon, maxLon),
+      ball_file::toGridCoordinate(pos.getLatDegree(), minLat, maxLat));
+  }
+
+  return radixSort(keys, aThreadCount);
+}
+
+void
+poi_ordering::sortPoiRuns(std::vector<osm_input::OsmPoi>& aPois,
+                          const std::vector<std::size_t>& aRunOffsets,
+                          int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+  SortKeys keys = computeDefaultKeys(aPois, aThreadCount);
+  permute(aPois, mergeRuns(keys, aRunOffsets, aThreadCount));
+}
+
+void
+poi_ordering::sortPoisByLevel(std::vector<osm_input::OsmPoi>& aPois,
+                              const mapping_helper::MappingHelper& aMapping,
+                              int32_t aThreadCount)
+{
+  aThreadCount = std::max(aThreadCount, 1);
+  std::size_t count = aPois.size();
+  if (count > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Poi ordering supports at most 2^32 elements");
+  }
+
+  // the buckets are indexed by level id directly
+  uint64_t maxLevelId = 0;
+  for (const auto* lvl : aMapping.getLevels()) {
+    maxLevelId = std::max(maxLevelId, lvl->mLevelId);
+  }
+  std::size_t bucketCount = maxLevelId + 1;
+  for (const auto& poi : aPois) {
+    if (poi.getLevel()->mLevelId >= bucketCount) {
+      // level of a different mapping, use the generic sort
+      sortPois(aPois, aThreadCount);
+      return;
+    }
+  }
+
+  // stable parallel counting sort by level id
+  std::vector<std::size_t> counts(aThreadCount * bucketCount, 0);
+  std::vector<std::size_t> bucketBegin(bucketCount + 1, 0);
+  std::vector<poiordering::LevelEntry> entries(count);
+#pragma omp parallel num_threads(aThreadCount)
+  {
+    std::size_t threads = omp_get_num_threads();
+    std::size_t thread = omp_get_thread_num();
+    std::size_t begin = count * thread / threads;
+    std::size_t end = count * (thread + 1) / threads;
+    std::size_t* local = counts.data() + thread * bucketCount;
+
+    for (std::size_t i = begin; i < end; ++i) {
+      ++local[aPois[i].getLevel()->mLevelId];
+    }
+
+#pragma omp barrier
+#pragma omp single
+    {
+      std::size_t offset = 0;
+      for (std::size_t b = 0; b < bucketCount; ++b) {
+        bucketBegin[b] = offset;
+        for (std::size_t t = 0; t < threads; ++t) {
+          std::size_t c = counts[t * bucketCount + b];
+          counts[t * bucketCount + b] = offset;
+          offset += c;
+        }
+      }
+      bucketBegin[bucketCount] = offset;
+    }
+
+    for (std::size_t i = begin; i < end; ++i) {
+      const osm_input::OsmPoi& poi = aPois[i];
+      std::size_t pos = local[poi.getLevel()->mLevelId]++;
+      entries[pos] = { poi.getRankingValue(), poi.getOsmId(), (uint32_t)i };
+    }
+  }
+
+  std::vector<std::size_t> buckets;
+  for (std::size_t b = 0; b < bucketCount; ++b) {
+    if (bucketBegin[b + 1] - bucketBegin[b] > 1) {
+      buckets.push_back(b);
+    }
+  }
+  std::sort(buckets.begin(),
+            buckets.end(),
+            [&](std::size_t aFirst, std::size_t aSecond) {
+              return bucketBegin[aFirst + 1] - bucketBegin[aFirst] >
+                     bucketBegin[aSecond + 1] - bucketBegin[aSecond];
+            });
+
+#pragma omp parallel for num_threads(aThreadCount) schedule(dynamic, 1)
+  for (int64_t i = 0; i < (int64_t)buckets.size(); ++i) {
+    std::size_t b = buckets[i];
+    std::sort(entries.begin() + bucketBegin[b],
+              entries.begin() + bucketBegin[b + 1]);
+  }
+
+  std::vector<uint32_t> order(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    order[i] = entries[i].mIndex;
+  }
+
+  permute(aPois, order);
+}
+
+void
+poi_ordering::keepMostImportant(std::vector<osm_input::OsmPoi>& aPois,
+                                std::size_t aCount,
+                                const Ranking& aRanking,
+                                int32_t aThreadCount)
+{
+  if (aPois.size() <= aCount) {
+    return;
+  }
+  if (aPois.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Poi ordering supports at most 2^32 elements");
+  }
+
+  aThreadCount = std::max(aThreadCount, 1);
+  SortKeys keys = aRanking.computeKeys(aPois, aThreadCount);
+  std::size_t words = keys.mWords;
+  std::vector<uint32_t> order(aPois.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = (uint32_t)i;
+  }
+
+  std::nth_element(
+    order.begin(),
+    order.begin() + aCount,
+    order.end(),
+    [&](uint32_t aFirst, uint32_t aSecond) {
+      return poiordering::keyLess(keys.get(aSecond), keys.get(aFirst), words);
+    });
+  order.resize(aCount);
+
+  permute(aPois, order);
+}
+
+poi_ordering::TopPoiHeap::TopPoiHeap(std::size_t aCapacity,
+                                     const Ranking& aRanking)
+  : mCapacity(aCapacity)
+  , mRanking(aRanking)
+  , mWords(aRanking.keyWords())
+  , mCandidate(aRanking.keyWords())
+{
+  if (aCapacity > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Poi ordering supports at most 2^32 elements");
+  }
+}
+
+bool
+poi_ordering::TopPoiHeap::slotGreater(uint32_t aFirst, uint32_t aSecond) const
+{
+  return poiordering::keyLess(
+    mKeys.data() + aSecond * mWords, mKeys.data() + aFirst * mWords, mWords);
+}
+
+bool
+poi_ordering::TopPoiHeap::admits(
+  const mapping_helper::MappingHelper::Level* aLevel,
+  const osm_input::NumericTags& aNumericTags,
+  int64_t aOsmId)
+{
+  if (mCapacity == 0) {
+    return false;
+  }
+
+  mRanking.computeKey(aLevel, aNumericTags, aOsmId, mCandidate.data());
+  if (mHeap.size() < mCapacity) {
+    return true;
+  }
+
+  return poiordering::keyLess(
+    mKeys.data() + mHeap.front() * mWords, mCandidate.data(), mWords);
+}
+
+void
+poi_ordering::TopPoiHeap::push(osm_input::OsmPoi&& aPoi)
+{
+  auto cmp = [this](uint32_t aFirst, uint32_t aSecond) {
+    return slotGreater(aFirst, aSecond);
+  };
+
+  uint32_t slot;
+  if (mHeap.size() < mCapacity) {
+    slot = (uint32_t)mPois.size();
+    mPois.push_back(std::move(aPoi));
+    mKeys.insert(mKeys.end(), mCandidate.begin(), mCandidate.end());
+    mHeap.push_back(slot);
+  } else {
+    // replace the least important poi
+    std::pop_heap(mHeap.begin(), mHeap.end(), cmp);
+    slot = mHeap.back();
+    mPois[slot] = std::move(aPoi);
+    std::copy(
+      mCandidate.begin(), mCandidate.end(), mKeys.begin() + slot * mWords);
+  }
+  std::push_heap(mHeap.begin(), mHeap.end(), cmp);
+}
+
+std::vector<osm_input::OsmPoi>
+poi_ordering::TopPoiHeap::release()
+{
+  std::vector<osm_input::OsmPoi> result;
+  result.swap(mPois);
+  mKeys.clear();
+  mHeap.clear();
+
+  return result;
+}
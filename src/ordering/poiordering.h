@@ -0,0 +1,195 @@
+/*
+ * Compute the importance order of a poi set
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef POIORDERING_H
+#define POIORDERING_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "mappinghelper.h"
+#include "osmpoi.h"
+
+namespace poi_ordering {
+
+class Ranking;
+
+/**
+ * Flat array of sort keys. Every element owns mWords consecutive 64 bit
+ * words which are compared lexicographically as unsigned integers.
+ */
+struct SortKeys
+{
+  std::size_t mWords;
+  std::vector<uint64_t> mKeys;
+
+  SortKeys()
+    : mWords(0){};
+
+  SortKeys(std::size_t aCount, std::size_t aWords)
+    : mWords(aWords)
+    , mKeys(aCount * aWords, 0){};
+
+  std::size_t size() const { return (mWords > 0) ? mKeys.size() / mWords : 0; };
+
+  uint64_t* get(std::size_t aIdx) { return mKeys.data() + aIdx * mWords; };
+  const uint64_t* get(std::size_t aIdx) const
+  {
+    return mKeys.data() + aIdx * mWords;
+  };
+};
+
+/**
+ * Map a signed integer to an unsigned one preserving the order.
+ */
+inline uint64_t
+toOrderedKey(int64_t aValue)
+{
+  return (uint64_t)aValue ^ (uint64_t(1) << 63);
+}
+
+/**
+ * Compute the keys of the order defined by OsmPoi::operator< (level id,
+ * ranking value, osm id). Level id and ranking value are packed into a single
+ * word if they fit, so most poi sets are sorted on 128 bit keys.
+ */
+SortKeys computeDefaultKeys(const std::vector<osm_input::OsmPoi>& aPois,
+                            int32_t aThreadCount);
+
+/**
+ * Stable parallel LSD radix sort of the keys. Returns the permutation:
+ * result[i] is the index of the i-th smallest element. Byte positions that
+ * are equal for all keys are skipped.
+ */
+std::vector<uint32_t> radixSort(const SortKeys& aKeys, int32_t aThreadCount);
+
+/**
+ * Merge consecutive sorted runs of keys into one order. Run i covers the
+ * elements [aRunOffsets[i], aRunOffsets[i + 1]), the first one has to start at
+ * 0 and the last one ends at the end of the keys. All runs are merged at once
+ * with a heap; the output is split into equally sized chunks along the merge
+ * path, which are merged in parallel. Equal keys keep their relative order.
+ *
+ * Returns the permutation like radixSort.
+ */
+std::vector<uint32_t> mergeRuns(const SortKeys& aKeys,
+                                const std::vector<std::size_t>& aRunOffsets,
+                                int32_t aThreadCount);
+
+/**
+ * Reorder the pois such that aPois[i] becomes the former aPois[aOrder[i]].
+ * Every poi is moved exactly once.
+ */
+void permute(std::vector<osm_input::OsmPoi>& aPois,
+             const std::vector<uint32_t>& aOrder);
+
+/**
+ * Sort the pois by OsmPoi::operator< using packed keys and radix sort.
+ */
+void sortPois(std::vector<osm_input::OsmPoi>& aPois, int32_t aThreadCount);
+
+/**
+ * Sort the pois by the keys of aRanking using radix sort.
+ */
+void sortPois(std::vector<osm_input::OsmPoi>& aPois,
+              const Ranking& aRanking,
+              int32_t aThreadCount);
+
+/**
+ * Sort pois that already consist of sorted runs (see mergeRuns), e.g. the
+ * per thread runs sorted by the import threads.
+ */
+void sortPoiRuns(std::vector<osm_input::OsmPoi>& aPois,
+                 const std::vector<std::size_t>& aRunOffsets,
+                 int32_t aThreadCount);
+
+/**
+ * Order of the positions along the 64 bit Hilbert curve through their
+ * bounding box, computed with radixSort. Returns the permutation like
+ * radixSort: result[i] is the index of the i-th position on the curve.
+ */
+std::vector<uint32_t> computeHilbertOrder(
+  const std::vector<osm_input::OsmPoi::Position>& aPositions,
+  int32_t aThreadCount);
+
+/**
+ * Reduce the pois to the aCount most important ones with respect to
+ * aRanking. The remaining pois are not sorted.
+ */
+void keepMostImportant(std::vector<osm_input::OsmPoi>& aPois,
+                       std::size_t aCount,
+                       const Ranking& aRanking,
+                       int32_t aThreadCount);
+
+/**
+ * Bounded min heap of the most important pois seen so far. The least important
+ * poi of the selection is at the front, so a candidate is rejected with a
+ * single key comparison once the heap is full.
+ */
+class TopPoiHeap
+{
+public:
+  TopPoiHeap(std::size_t aCapacity, const Ranking& aRanking);
+
+  /**
+   * Compute the ranking key of a candidate. Returns true if it enters the
+   * selection, the poi has to be handed to push() before the next call then.
+   */
+  bool admits(const mapping_helper::MappingHelper::Level* aLevel,
+              const osm_input::NumericTags& aNumericTags,
+              int64_t aOsmId);
+
+  // add the poi last accepted by admits()
+  void push(osm_input::OsmPoi&& aPoi);
+
+  std::size_t size() const { return mHeap.size(); };
+
+  // hand out the selection and leave the heap empty
+  std::vector<osm_input::OsmPoi> release();
+
+private:
+  std::size_t mCapacity;
+  const Ranking& mRanking;
+  std::size_t mWords;
+
+  // pois and keys stored by slot, mHeap orders the slots
+  std::vector<osm_input::OsmPoi> mPois;
+  std::vector<uint64_t> mKeys;
+  std::vector<uint32_t> mHeap;
+  std::vector<uint64_t> mCandidate;
+
+  // heap order: the least important slot at the front
+  bool slotGreater(uint32_t aFirst, uint32_t aSecond) const;
+};
+
+/**
+ * Sort the pois into the same order as sortPois by counting sort into one
+ * bucket per level of aMapping, followed by sorting every bucket by ranking
+ * value and osm id. The buckets are sorted in parallel, largest first.
+ *
+ * Used for the hierarchy export, where only the grouping by level and the
+ * order within a level are written.
+ */
+void sortPoisByLevel(std::vector<osm_input::OsmPoi>& aPois,
+                     const mapping_helper::MappingHelper& aMapping,
+                     int32_t aThreadCount);
+} // namespace poi_ordering
+
+#endif // POIORDERING_H
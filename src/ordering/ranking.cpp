@@ -0,0 +1,257 @@
+/*
+ * Configurable importance order of the pois
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ranking.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+const std::size_t poi_ordering::Ranking::MAX_STACK;
+
+namespace ranking {
+const int64_t MAX_VALUE = std::numeric_limits<int64_t>::max();
+const int64_t MIN_VALUE = std::numeric_limits<int64_t>::min();
+
+int64_t
+saturatedAdd(int64_t aFirst, int64_t aSecond)
+{
+  int64_t result;
+  if (__builtin_add_overflow(aFirst, aSecond, &result)) {
+    return (aSecond > 0) ? MAX_VALUE : MIN_VALUE;
+  }
+  return result;
+}
+
+int64_t
+saturatedSub(int64_t aFirst, int64_t aSecond)
+{
+  int64_t result;
+  if (__builtin_sub_overflow(aFirst, aSecond, &result)) {
+    return (aSecond < 0) ? MAX_VALUE : MIN_VALUE;
+  }
+  return result;
+}
+
+int64_t
+saturatedMul(int64_t aFirst, int64_t aSecond)
+{
+  int64_t result;
+  if (__builtin_mul_overflow(aFirst, aSecond, &result)) {
+    return ((aFirst < 0) != (aSecond < 0)) ? MIN_VALUE : MAX_VALUE;
+  }
+  return result;
+}
+} // namespace ranking
+
+poi_ordering::Ranking::Ranking()
+  : mKeyCount(2)
+  , mIsDefault(true)
+{
+  emit(OpCode::LEVEL);
+  emit(OpCode::EMIT);
+  emit(OpCode::TAG, mapping_helper::MappingHelper::RANKING_TAG_SLOT, 0);
+  emit(OpCode::EMIT);
+}
+
+poi_ordering::Ranking::Ranking(const Json::Value& aRanking,
+                               mapping_helper::MappingHelper& aMapping)
+  : mKeyCount(0)
+  , mIsDefault(false)
+{
+  if (!aRanking.isArray() || aRanking.empty()) {
+    throw std::runtime_error("The ranking has to be a non-empty list of "
+                             "expressions!");
+  }
+
+  for (const auto& key : aRanking) {
+    compileKey(key, aMapping);
+  }
+}
+
+void
+poi_ordering::Ranking::compileKey(const Json::Value& aKey,
+                                  mapping_helper::MappingHelper& aMapping)
+{
+  if (compile(aKey, aMapping) > MAX_STACK) {
+    throw std::runtime_error("Ranking expression is nested too deeply!");
+  }
+  emit(OpCode::EMIT);
+  ++mKeyCount;
+}
+
+std::size_t
+poi_ordering::Ranking::compile(const Json::Value& aExpr,
+                               mapping_helper::MappingHelper& aMapping)
+{
+  if (aExpr.isString()) {
+    Json::Value expr;
+    if (aExpr.asString() == "level") {
+      expr["type"] = "level";
+    } else {
+      expr["type"] = "tag";
+      expr["tag"] = aExpr;
+    }
+    return compile(expr, aMapping);
+  }
+  if (!aExpr.isObject() || !aExpr["type"].isString()) {
+    throw std::runtime_error("Ranking expressions need a type!");
+  }
+
+  std::string type = aExpr["type"].asString();
+  if (type == "level") {
+    emit(OpCode::LEVEL);
+    return 1;
+  } else if (type == "tag") {
+    if (!aExpr["tag"].isString()) {
+      throw std::runtime_error("Ranking tag expressions need a tag!");
+    }
+    std::size_t slot = aMapping.requireNumericTag(aExpr["tag"].asString());
+    if (slot > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("Too many numeric tags for a ranking!");
+    }
+    emit(OpCode::TAG, (uint32_t)slot, aExpr.get("default", 0).asInt64());
+    return 1;
+  } else if (type == "value") {
+    if (!aExpr["value"].isIntegral()) {
+      throw std::runtime_error("Ranking values have to be integers!");
+    }
+    emit(OpCode::VALUE, 0, aExpr["value"].asInt64());
+    return 1;
+  } else if (type == "neg") {
+    std::size_t depth = compile(aExpr["operand"], aMapping);
+    emit(OpCode::NEG);
+    return depth;
+  } else if (type == "add") {
+    return compileOperator(OpCode::ADD, aExpr["operands"], aMapping);
+  } else if (type == "sub") {
+    return compileOperator(OpCode::SUB, aExpr["operands"], aMapping);
+  } else if (type == "mul") {
+    return compileOperator(OpCode::MUL, aExpr["operands"], aMapping);
+  } else if (type == "min") {
+    return compileOperator(OpCode::MIN, aExpr["operands"], aMapping);
+  } else if (type == "max") {
+    return compileOperator(OpCode::MAX, aExpr["operands"], aMapping);
+  }
+
+  throw std::runtime_error("Unknown ranking expression type " + type + "!");
+}
+
+std::size_t
+poi_ordering::Ranking::compileOperator(OpCode aOp,
+                                       const Json::Value& aOperands,
+                                       mapping_helper::MappingHelper& aMapping)
+{
+  if (!aOperands.isArray() || aOperands.empty()) {
+    throw std::runtime_error("Ranking operators need a list of operands!");
+  }
+
+  // left fold: the accumulated value stays on the stack
+  std::size_t depth = compile(aOperands[0], aMapping);
+  for (Json::ArrayIndex i = 1; i < aOperands.size(); ++i) {
+    depth = std::max(depth, 1 + compile(aOperands[i], aMapping));
+    emit(aOp);
+  }
+
+  return depth;
+}
+
+void
+poi_ordering::Ranking::emit(OpCode aOp, uint32_t aSlot, int64_t aValue)
+{
+  mCode.push_back({ aOp, aSlot, aValue });
+}
+
+void
+poi_ordering::Ranking::computeKey(
+  const mapping_helper::MappingHelper::Level* aLevel,
+  const osm_input::NumericTags& aNumericTags,
+  int64_t aOsmId,
+  uint64_t* aKey) const
+{
+  int64_t stack[MAX_STACK];
+  std::size_t top = 0;
+  uint64_t* key = aKey;
+
+  for (const Instruction& ins : mCode) {
+    switch (ins.mOp) {
+      case OpCode::LEVEL:
+        stack[top++] = (int64_t)aLevel->mLevelId;
+        break;
+      case OpCode::TAG:
+        stack[top++] = aNumericTags.getOrDefault(ins.mSlot, ins.mValue);
+        break;
+      case OpCode::VALUE:
+        stack[top++] = ins.mValue;
+        break;
+      case OpCode::ADD:
+        --top;
+        stack[top - 1] = ranking::saturatedAdd(stack[top - 1], stack[top]);
+        break;
+      case OpCode::SUB:
+        --top;
+        stack[top - 1] = ranking::saturatedSub(stack[top - 1], stack[top]);
+        break;
+      case OpCode::MUL:
+        --top;
+        stack[top - 1] = ranking::saturatedMul(stack[top - 1], stack[top]);
+        break;
+      case OpCode::MIN:
+        --top;
+        stack[top - 1] = std::min(stack[top - 1], stack[top]);
+        break;
+      case OpCode::MAX:
+        --top;
+        stack[top - 1] = std::max(stack[top - 1], stack[top]);
+        break;
+      case OpCode::NEG:
+        stack[top - 1] = ranking::saturatedSub(0, stack[top - 1]);
+        break;
+      case OpCode::EMIT:
+        *key++ = toOrderedKey(stack[--top]);
+        break;
+    }
+  }
+
+  *key = toOrderedKey(aOsmId);
+}
+
+void
+poi_ordering::Ranking::computeKey(const osm_input::OsmPoi& aPoi,
+                                  uint64_t* aKey) const
+{
+  computeKey(
+    aPoi.getLevel(), aPoi.getNumericTags(), aPoi.getOsmId(), aKey);
+}
+
+poi_ordering::SortKeys
+poi_ordering::Ranking::computeKeys(const std::vector<osm_input::OsmPoi>& aPois,
+                                   int32_t aThreadCount) const
+{
+  int64_t count = aPois.size();
+  SortKeys keys(count, keyWords());
+
+#pragma omp parallel for num_threads(aThreadCount) schedule(static)
+  for (int64_t i = 0; i < count; ++i) {
+    computeKey(aPois[i], keys.get(i));
+  }
+
+  return keys;
+}
@@ -0,0 +1,122 @@
+/*
+ * Configurable importance order of the pois
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef RANKING_H
+#define RANKING_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include "mappinghelper.h"
+#include "numerictags.h"
+#include "osmpoi.h"
+#include "poiordering.h"
+
+namespace poi_ordering {
+
+/**
+ * Importance order given by the "ranking" block of the config: a list of
+ * integer expressions compared lexicographically, larger values being more
+ * important. The osm id is always appended as the last tie breaker.
+ *
+ * Expressions are json nodes with a "type":
+ *  - "level": id of the mapping level (deeper / earlier levels are larger)
+ *  - "tag": numeric value of the tag "tag", "default" (0 if omitted) if the
+ *    poi does not carry it
+ *  - "value": the constant "value"
+ *  - "add", "sub", "mul", "min", "max": applied to the list "operands"
+ *    ("sub" subtracts all further operands from the first one)
+ *  - "neg": negation of "operand"
+ * A plain string is short for "level" or for a tag with default 0.
+ *
+ * All arithmetic saturates at the int64 limits. Without a ranking block the
+ * order is ["level", "population"], which is the order of OsmPoi::operator<.
+ *
+ * The expressions are compiled once into a stack bytecode over the numeric
+ * tag slots of the mapping.
+ */
+class Ranking
+{
+public:
+  // the order of OsmPoi::operator<
+  Ranking();
+  // throws std::runtime_error for malformed expressions
+  Ranking(const Json::Value& aRanking, mapping_helper::MappingHelper& aMapping);
+
+  // true if this is the order of OsmPoi::operator<
+  bool isDefault() const { return mIsDefault; };
+
+  // number of key words per poi, including the osm id
+  std::size_t keyWords() const { return mKeyCount + 1; };
+
+  void computeKey(const mapping_helper::MappingHelper::Level* aLevel,
+                  const osm_input::NumericTags& aNumericTags,
+                  int64_t aOsmId,
+                  uint64_t* aKey) const;
+  void computeKey(const osm_input::OsmPoi& aPoi, uint64_t* aKey) const;
+
+  SortKeys computeKeys(const std::vector<osm_input::OsmPoi>& aPois,
+                       int32_t aThreadCount) const;
+
+private:
+  enum class OpCode : uint8_t
+  {
+    LEVEL,
+    TAG,
+    VALUE,
+    ADD,
+    SUB,
+    MUL,
+    MIN,
+    MAX,
+    NEG,
+    EMIT
+  };
+
+  struct Instruction
+  {
+    OpCode mOp;
+    uint32_t mSlot;
+    int64_t mValue;
+  };
+
+  // evaluation stack size, deeper expressions are rejected
+  static const std::size_t MAX_STACK = 32;
+
+  std::vector<Instruction> mCode;
+  std::size_t mKeyCount;
+  bool mIsDefault;
+
+  void compileKey(const Json::Value& aKey,
+                  mapping_helper::MappingHelper& aMapping);
+  // returns the stack depth needed by the expression
+  std::size_t compile(const Json::Value& aExpr,
+                      mapping_helper::MappingHelper& aMapping);
+  std::size_t compileOperator(OpCode aOp,
+                              const Json::Value& aOperands,
+                              mapping_helper::MappingHelper& aMapping);
+  void emit(OpCode aOp, uint32_t aSlot = 0, int64_t aValue = 0);
+};
+} // namespace poi_ordering
+
+#endif // RANKING_H
@@ -0,0 +1,256 @@
+/*
+ * Byte buffer with fast number formatting for the text output
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "formatbuffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <limits>
+#include <math.h>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <zlib.h>
+
+const int32_t text_output::FormatBuffer::MAX_FAST_PRECISION;
+
+namespace formatbuffer {
+typedef unsigned __int128 uint128_t;
+
+const uint64_t POW10[] = { 1ull,
+                           10ull,
+                           100ull,
+                           1000ull,
+                           10000ull,
+                           100000ull,
+                           1000000ull,
+                           10000000ull,
+                           100000000ull,
+                           1000000000ull,
+                           10000000000ull,
+                           100000000000ull,
+                           1000000000000ull,
+                           10000000000000ull,
+                           100000000000000ull,
+                           1000000000000000ull,
+                           10000000000000000ull,
+                           100000000000000000ull };
+
+// digits of aValue, written backwards in front of aEnd; returns the start
+char*
+formatDigits(uint64_t aValue, char* aEnd)
+{
+  do {
+    *--aEnd = (char)('0' + aValue % 10);
+    aValue /= 10;
+  } while (aValue != 0);
+
+  return aEnd;
+}
+} // namespace formatbuffer
+
+void
+text_output::FormatBuffer::appendUnsigned(uint64_t aValue)
+{
+  char digits[20];
+  char* end = digits + sizeof(digits);
+  char* begin = formatbuffer::formatDigits(aValue, end);
+  append(begin, end - begin);
+}
+
+void
+text_output::FormatBuffer::appendSigned(int64_t aValue)
+{
+  if (aValue < 0) {
+    append('-');
+    appendUnsigned(0 - (uint64_t)aValue);
+  } else {
+    appendUnsigned(aValue);
+  }
+}
+
+void
+text_output::FormatBuffer::appendFixed(double aValue, int32_t aPrecision)
+{
+  int exponent;
+  double mantissa = std::frexp(std::fabs(aValue), &exponent);
+  // |aValue| = m * 2^-shift with an integral m < 2^53
+  uint64_t m = (uint64_t)std::ldexp(mantissa, 53);
+  int32_t shift = 53 - exponent;
+
+  // values of 2^53 and above and non finite values are rare here
+  if (!std::isfinite(aValue) || aPrecision < 0 ||
+      aPrecision > MAX_FAST_PRECISION || shift < 0) {
+    char buffer[512];
+    int length =
+      std::snprintf(buffer, sizeof(buffer), "%.*f", aPrecision, aValue);
+    if (length >= (int)sizeof(buffer)) {
+      std::vector<char> large(length + 1);
+      std::snprintf(large.data(), large.size(), "%.*f", aPrecision, aValue);
+      append(large.data(), length);
+    } else {
+      append(buffer, length);
+    }
+    return;
+  }
+
+  // aValue * 10^precision = m * 10^precision / 2^shift, the product has
+  // less than 53 + 57 bits
+  formatbuffer::uint128_t scaled =
+    (formatbuffer::uint128_t)m * formatbuffer::POW10[aPrecision];
+  formatbuffer::uint128_t rounded;
+  if (shift == 0) {
+    rounded = scaled;
+  } else if (shift >= 120) {
+    // smaller than 2^-67 * 10^-precision, always rounds to 0
+    rounded = 0;
+  } else {
+    rounded = scaled >> shift;
+    formatbuffer::uint128_t rest = scaled - (rounded << shift);
+    formatbuffer::uint128_t half = (formatbuffer::uint128_t)1 << (shift - 1);
+    if (rest > half || (rest == half && (rounded & 1) != 0)) {
+      ++rounded;
+    }
+  }
+
+  if (std::signbit(aValue)) {
+    append('-');
+  }
+  uint64_t integral = (uint64_t)(rounded / formatbuffer::POW10[aPrecision]);
+  uint64_t fraction = (uint64_t)(rounded % formatbuffer::POW10[aPrecision]);
+  appendUnsigned(integral);
+  if (aPrecision > 0) {
+    char digits[MAX_FAST_PRECISION + 1];
+    digits[0] = '.';
+    for (int32_t i = aPrecision; i > 0; --i) {
+      digits[i] = (char)('0' + fraction % 10);
+      fraction /= 10;
+    }
+    append(digits, aPrecision + 1);
+  }
+}
+
+void
+text_output::FormatBuffer::appendEscapedLabel(const std::string& aLabel)
+{
+  const char* begin = aLabel.data();
+  const char* end = begin + aLabel.size();
+  while (begin != end) {
+    const char* newline =
+      static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    if (!newline) {
+      append(begin, end - begin);
+      return;
+    }
+    append(begin, newline - begin);
+    append("\\n", 2);
+    begin = newline + 1;
+  }
+}
+
+void
+text_output::FormatBuffer::appendGzipMember(const char* aData,
+                                            std::size_t aSize,
+                                            int32_t aLevel)
+{
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  // 16 + 15: gzip header and trailer around a deflate stream with 32k window
+  if (deflateInit2(
+        &stream, aLevel, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Initializing the gzip compression failed!");
+  }
+
+  std::size_t begin = mData.size();
+  mData.resize(begin + deflateBound(&stream, aSize));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(aData));
+  stream.avail_in = 0;
+  stream.next_out = reinterpret_cast<Bytef*>(mData.data() + begin);
+  stream.avail_out = 0;
+
+  // avail_in and avail_out are 32 bit: pass the data in windows of at most
+  // UINT_MAX bytes
+  const std::size_t window = std::numeric_limits<uInt>::max();
+  std::size_t inLeft = aSize;
+  std::size_t outLeft = mData.size() - begin;
+  int result = Z_OK;
+  while (result == Z_OK) {
+    if (stream.avail_in == 0) {
+      stream.avail_in = (uInt)std::min(inLeft, window);
+      inLeft -= stream.avail_in;
+    }
+    if (stream.avail_out == 0) {
+      stream.avail_out = (uInt)std::min(outLeft, window);
+      outLeft -= stream.avail_out;
+    }
+    result = deflate(&stream, (inLeft == 0) ? Z_FINISH : Z_NO_FLUSH);
+  }
+  mData.resize(mData.size() - outLeft - stream.avail_out);
+  deflateEnd(&stream);
+
+  if (result != Z_STREAM_END) {
+    throw std::runtime_error("Gzip compression failed!");
+  }
+}
+
+bool
+text_output::FormatBuffer::writeTo(int aFd)
+{
+  const char* data = mData.data();
+  std::size_t remaining = mData.size();
+  while (remaining > 0) {
+    ssize_t written = write(aFd, data, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    remaining -= written;
+  }
+  mData.clear();
+
+  return true;
+}
+
+bool
+text_output::FormatBuffer::writeAt(int aFd, int64_t aOffset) const
+{
+  const char* data = mData.data();
+  std::size_t remaining = mData.size();
+  while (remaining > 0) {
+    ssize_t written = pwrite(aFd, data, remaining, aOffset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    remaining -= written;
+    aOffset += written;
+  }
+
+  return true;
+}
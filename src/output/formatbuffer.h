@@ -0,0 +1,88 @@
+/*
+ * Byte buffer with fast number formatting for the text output
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FORMATBUFFER_H
+#define FORMATBUFFER_H
+
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace text_output {
+
+/**
+ * Append only byte buffer. The number formats match the output of a
+ * std::ostream in the "C" locale, appendFixed(v, p) equals
+ * std::fixed << std::setprecision(p) << v (and printf("%.*f", p, v)).
+ */
+class FormatBuffer
+{
+public:
+  // largest precision handled without snprintf
+  static const int32_t MAX_FAST_PRECISION = 17;
+
+  FormatBuffer() = default;
+  FormatBuffer(std::size_t aCapacity) { mData.reserve(aCapacity); };
+
+  void append(char aChar) { mData.push_back(aChar); };
+  void append(const char* aData, std::size_t aSize)
+  {
+    mData.insert(mData.end(), aData, aData + aSize);
+  };
+  void append(const std::string& aStr) { append(aStr.data(), aStr.size()); };
+
+  void appendUnsigned(uint64_t aValue);
+  void appendSigned(int64_t aValue);
+  /**
+   * Exact decimal expansion of aValue rounded to aPrecision fraction digits,
+   * ties to even
+   */
+  void appendFixed(double aValue, int32_t aPrecision);
+  // aLabel with every newline written as "\n"
+  void appendEscapedLabel(const std::string& aLabel);
+
+  /**
+   * Append aData compressed to an independent gzip member. Concatenated
+   * members form a valid gzip file, so chunks can be compressed in parallel.
+   * aLevel is the zlib compression level, level 0 stores the data and the
+   * size of the member only depends on aSize.
+   */
+  void appendGzipMember(const char* aData, std::size_t aSize, int32_t aLevel);
+
+  const char* data() const { return mData.data(); };
+  std::size_t size() const { return mData.size(); };
+  void clear() { mData.clear(); };
+  void swap(FormatBuffer& aOther) { mData.swap(aOther.mData); };
+
+  /**
+   * Write the buffer to the file descriptor and clear it. Returns false if
+   * the write failed.
+   */
+  bool writeTo(int aFd);
+  // write the buffer at aOffset of the file (pwrite), keeps the buffer
+  bool writeAt(int aFd, int64_t aOffset) const;
+
+private:
+  std::vector<char> mData;
+};
+} // namespace text_output
+
+#endif // FORMATBUFFER_H
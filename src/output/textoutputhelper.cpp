@@ -19,13 +19,28 @@
 
 #include "textoutputhelper.h"
 
+#include <algorithm>
+#include <cstring>
+#include <exception>
 #include <iomanip>
 #include <math.h>
+#include <memory>
+#include <stdexcept>
 
+#include <fcntl.h>
+#include <omp.h>
+#include <unistd.h>
+
+#include "ballfile.h"
+#include "formatbuffer.h"
 #include "osmpoi.h"
+#include "poiordering.h"
 
 namespace text_output {
+const int32_t COORDINATE_PRECISION = 17;
 const int32_t RADIUS_PRECISION = 3;
+// number of balls formatted into one buffer
+const std::size_t CHUNK_SIZE = 1 << 15;
 
 double
 ceil(double aValue, int32_t aPrecision)
@@ -33,35 +48,450 @@ ceil(double aValue, int32_t aPrecision)
   return std::ceil(aValue * std::pow(10, aPrecision)) /
          std::pow(10, aPrecision);
 }
-} // namespace text_output
 
+// width of the count line of a streamed file, fits every uint64_t
+const int32_t STREAM_COUNT_WIDTH = 20;
+// zlib level of the compressed outputs
+const int32_t GZIP_LEVEL = 6;
+// size of the blocks of the binary file compressed at once
+const std::size_t BINARY_BLOCK_SIZE = 1 << 22;
+
+/**
+ * Replace the content of aBuffer by a gzip member of it, aTemp is used as
+ * scratch space. Empty buffers stay empty.
+ */
+void
+compressBuffer(FormatBuffer& aBuffer, FormatBuffer& aTemp, int32_t aLevel)
+{
+  if (aBuffer.size() == 0) {
+    return;
+  }
+  aTemp.clear();
+  aTemp.appendGzipMember(aBuffer.data(), aBuffer.size(), aLevel);
+  aBuffer.swap(aTemp);
+}
+
+/**
+ * Owner of a file descriptor, closes it unless release was called, so
+ * exceptions do not leak it.
+ */
+class FileDescriptor
+{
+public:
+  explicit FileDescriptor(int aFd)
+    : mFd(aFd){};
+  FileDescriptor(const FileDescriptor& other) = delete;
+  FileDescriptor& operator=(const FileDescriptor& other) = delete;
+  ~FileDescriptor()
+  {
+    if (mFd >= 0) {
+      close(mFd);
+    }
+  };
+
+  int get() const { return mFd; };
+
+  // hand the descriptor to the caller, who closes it
+  int release()
+  {
+    int fd = mFd;
+    mFd = -1;
+    return fd;
+  };
+
+private:
+  int mFd;
+};
+
+/**
+ * Write the lines of aCount balls starting at aOffset of the file and
+ * advance aOffset. aFormat(buffer, begin, end) appends the lines of the balls
+ * [begin, end). Every thread formats (and compresses) one chunk per round,
+ * the chunks of a round are written in parallel at their prefix summed
+ * offsets.
+ */
+template <typename FormatFunc>
 bool
-text_output::TextOutputHelper::writeBallsFile(
-  const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
-  char aSep)
+writeChunks(int aFd,
+            int64_t& aOffset,
+            std::size_t aCount,
+            int32_t aThreadCount,
+            bool aCompress,
+            FormatFunc aFormat)
 {
-  std::ofstream file(mOutputPath.c_str());
+  bool success = true;
+  int32_t threads = std::max(aThreadCount, 1);
+  std::vector<FormatBuffer> buffers(threads);
+  std::vector<FormatBuffer> temps(aCompress ? threads : 0);
+  std::vector<int64_t> offsets(threads);
+  std::exception_ptr error;
+  for (std::size_t round = 0; round < aCount && success;
+       round += threads * CHUNK_SIZE) {
+#pragma omp parallel num_threads(threads)
+    {
+      int32_t t = omp_get_thread_num();
+      std::size_t begin = std::min(aCount, round + t * CHUNK_SIZE);
+      std::size_t end = std::min(aCount, begin + CHUNK_SIZE);
+      buffers[t].clear();
+      // exceptions must not leave the parallel region
+      try {
+        aFormat(buffers[t], begin, end);
+        if (aCompress) {
+          compressBuffer(buffers[t], temps[t], GZIP_LEVEL);
+        }
+      } catch (...) {
+#pragma omp critical
+        if (!error) {
+          error = std::current_exception();
+        }
+        buffers[t].clear();
+      }
 
-  if (!file.is_open()) {
+#pragma omp barrier
+#pragma omp single
+      {
+        for (int32_t i = 0; i < threads; ++i) {
+          offsets[i] = aOffset;
+          aOffset += buffers[i].size();
+        }
+      }
+
+      if (!buffers[t].writeAt(aFd, offsets[t])) {
+#pragma omp critical
+        success = false;
+      }
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  return success;
+}
+
+/**
+ * Write the count line followed by the lines of aCount balls, see
+ * writeChunks.
+ */
+template <typename FormatFunc>
+bool
+writeChunked(const std::string& aPath,
+             std::size_t aCount,
+             int32_t aThreadCount,
+             bool aCompress,
+             FormatFunc aFormat)
+{
+  FileDescriptor fd(open(aPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (fd.get() < 0) {
     return false;
   }
-  file.clear();
 
-  std::size_t importance = 0;
-  file << aBalls.size();
+  FormatBuffer header;
+  header.appendUnsigned(aCount);
+  if (aCompress) {
+    FormatBuffer temp;
+    compressBuffer(header, temp, GZIP_LEVEL);
+  }
+  bool success = header.writeAt(fd.get(), 0);
+  int64_t offset = header.size();
+  success = success && writeChunks(fd.get(), offset, aCount, aThreadCount,
+                                   aCompress, aFormat);
+
+  return close(fd.release()) == 0 && success;
+}
+
+/**
+ * The count line of a streamed file, right aligned to STREAM_COUNT_WIDTH.
+ * Compressed files store it in a member of level 0, whose size does not
+ * depend on the count.
+ */
+FormatBuffer
+streamHeader(std::size_t aCount, bool aCompress)
+{
+  FormatBuffer count;
+  count.appendUnsigned(aCount);
+  FormatBuffer header;
+  for (std::size_t i = count.size(); i < STREAM_COUNT_WIDTH; ++i) {
+    header.append(' ');
+  }
+  header.append(count.data(), count.size());
+  if (aCompress) {
+    compressBuffer(header, count, 0);
+  }
+
+  return header;
+}
 
-  for (auto& ball : aBalls) {
+/**
+ * Append the complete file lines of the balls [aBegin, aEnd), the first ball
+ * of aBalls has the importance aFirstIndex.
+ */
+void
+formatCompleteLines(
+  FormatBuffer& aBuffer,
+  const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+  std::size_t aBegin,
+  std::size_t aEnd,
+  std::size_t aFirstIndex,
+  char aSep,
+  bool aExportHierarchy)
+{
+  for (std::size_t i = aBegin; i < aEnd; ++i) {
+    const auto& ball = aBalls[i];
     double radius_ceiled =
       text_output::ceil(ball.mBallRadius, RADIUS_PRECISION);
-    file << "\n"
-         << std::fixed << std::setprecision(17) << ball.mPos.getLatDegree()
-         << aSep << ball.mPos.getLonDegree() << aSep << importance++ << aSep
-         << std::setprecision(RADIUS_PRECISION) << radius_ceiled;
+
+    // the importance of a ball is its index
+    std::size_t level =
+      (aExportHierarchy) ? ball.mHierarchyLevel : aFirstIndex + i;
+
+    aBuffer.append('\n');
+    aBuffer.appendFixed(ball.mPos.getLatDegree(), COORDINATE_PRECISION);
+    aBuffer.append(aSep);
+    aBuffer.appendFixed(ball.mPos.getLonDegree(), COORDINATE_PRECISION);
+    aBuffer.append(aSep);
+    aBuffer.appendUnsigned(level);
+    aBuffer.append(aSep);
+    aBuffer.appendFixed(radius_ceiled, RADIUS_PRECISION);
+    aBuffer.append(aSep);
+    aBuffer.appendSigned(ball.mOsmId);
+    aBuffer.append(aSep);
+    aBuffer.append('\'');
+    aBuffer.appendEscapedLabel(ball.mLabel);
+    aBuffer.append('\'');
+    aBuffer.append(aSep);
+    // the label factor shares the fixed precision of the radius
+    aBuffer.appendFixed(ball.mLabelFactor, RADIUS_PRECISION);
   }
+}
 
-  file.close();
+/**
+ * Sequential writer of the binary ball file, tracks the position to align
+ * the sections. Compressed files are written as one gzip member per block.
+ */
+class BinaryWriter
+{
+public:
+  BinaryWriter(const std::string& aPath, bool aCompress)
+    : mFd(open(aPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))
+    , mCompress(aCompress)
+    , mGood(mFd >= 0)
+    , mPosition(0){};
+  BinaryWriter(const BinaryWriter& other) = delete;
+  BinaryWriter& operator=(const BinaryWriter& other) = delete;
+  ~BinaryWriter()
+  {
+    if (mFd >= 0) {
+      close(mFd);
+    }
+  };
 
-  return true;
+  bool isOpen() const { return mFd >= 0; };
+  uint64_t position() const { return mPosition; };
+
+  void write(const void* aData, std::size_t aSize)
+  {
+    // split large writes, the buffer is flushed whenever it is full, so no
+    // block grows beyond BINARY_BLOCK_SIZE
+    const char* data = static_cast<const char*>(aData);
+    while (aSize > 0) {
+      std::size_t size = std::min(aSize, BINARY_BLOCK_SIZE - mBuffer.size());
+      mBuffer.append(data, size);
+      mPosition += size;
+      data += size;
+      aSize -= size;
+      if (mBuffer.size() >= BINARY_BLOCK_SIZE) {
+        flush();
+      }
+    }
+  };
+
+  // pad with zeros up to aOffset
+  void seek(uint64_t aOffset)
+  {
+    static const char ZEROS[ball_file::ALIGNMENT] = {};
+    while (mPosition < aOffset) {
+      write(ZEROS, std::min<uint64_t>(aOffset - mPosition, sizeof(ZEROS)));
+    }
+  };
+
+  /**
+   * Write aCount values aValue(i) of type T in blocks
+   */
+  template <typename T, typename ValueFunc>
+  void writeColumn(uint64_t aOffset, std::size_t aCount, ValueFunc aValue)
+  {
+    seek(aOffset);
+    std::vector<T> block;
+    block.reserve(CHUNK_SIZE);
+    for (std::size_t i = 0; i < aCount; ++i) {
+      block.push_back(aValue(i));
+      if (block.size() == CHUNK_SIZE) {
+        write(block.data(), block.size() * sizeof(T));
+        block.clear();
+      }
+    }
+    write(block.data(), block.size() * sizeof(T));
+  };
+
+  // write the buffered data and close the file, returns false on any error
+  bool finish()
+  {
+    flush();
+    mGood = close(mFd) == 0 && mGood;
+    mFd = -1;
+    return mGood;
+  };
+
+private:
+  int mFd;
+  bool mCompress;
+  bool mGood;
+  uint64_t mPosition;
+  FormatBuffer mBuffer;
+  FormatBuffer mTemp;
+
+  void flush()
+  {
+    if (mCompress) {
+      compressBuffer(mBuffer, mTemp, GZIP_LEVEL);
+    }
+    mGood = mBuffer.writeTo(mFd) && mGood;
+    mBuffer.clear();
+  };
+};
+
+/**
+ * Packed Hilbert R-tree over the ball centers, see ballfile.h
+ */
+struct BallIndex
+{
+  std::vector<double> mBoxes;
+  std::vector<uint64_t> mRefs;
+  std::vector<uint64_t> mLevels;
+
+  BallIndex(const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+            int32_t aThreadCount)
+  {
+    std::size_t count = aBalls.size();
+    uint64_t nodeSize = ball_file::INDEX_NODE_SIZE;
+
+    // level sizes: the leaves, then the groups of nodeSize children
+    uint64_t nodes = count;
+    uint64_t levelSize = count;
+    mLevels.push_back(nodes);
+    do {
+      levelSize = (levelSize + nodeSize - 1) / nodeSize;
+      nodes += levelSize;
+      mLevels.push_back(nodes);
+    } while (levelSize != 1);
+    mBoxes.resize(4 * nodes);
+    mRefs.resize(nodes);
+
+    std::vector<osm_input::OsmPoi::Position> positions;
+    positions.reserve(count);
+    for (const auto& ball : aBalls) {
+      positions.push_back(ball.mPos);
+    }
+    std::vector<uint32_t> order =
+      poi_ordering::computeHilbertOrder(positions, aThreadCount);
+
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto& pos = aBalls[order[i]].mPos;
+      double* box = mBoxes.data() + 4 * i;
+      box[0] = box[2] = pos.getLatDegree();
+      box[1] = box[3] = pos.getLonDegree();
+      mRefs[i] = order[i];
+    }
+
+    uint64_t levelBegin = 0;
+    for (std::size_t l = 1; l < mLevels.size(); ++l) {
+      uint64_t node = mLevels[l - 1];
+      for (uint64_t child = levelBegin; child < mLevels[l - 1];
+           child += nodeSize, ++node) {
+        double* box = mBoxes.data() + 4 * node;
+        const double* first = mBoxes.data() + 4 * child;
+        std::copy(first, first + 4, box);
+        uint64_t end = std::min(child + nodeSize, mLevels[l - 1]);
+        for (uint64_t c = child + 1; c < end; ++c) {
+          const double* other = mBoxes.data() + 4 * c;
+          box[0] = std::min(box[0], other[0]);
+          box[1] = std::min(box[1], other[1]);
+          box[2] = std::max(box[2], other[2]);
+          box[3] = std::max(box[3], other[3]);
+        }
+        mRefs[node] = child;
+      }
+      levelBegin = mLevels[l - 1];
+    }
+  };
+};
+
+// escape the separators of the poi file format
+std::string
+escape(const std::string& aInput)
+{
+  std::string result;
+  result.reserve(aInput.size());
+
+  for (char c : aInput) {
+    switch (c) {
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\r':
+        result += "\\r";
+        break;
+      default:
+        result += c;
+        break;
+    }
+  }
+
+  return result;
+}
+} // namespace text_output
+
+bool
+text_output::TextOutputHelper::isGzipPath(const std::string& aPath)
+{
+  const std::string EXTENSION = ".gz";
+  return aPath.size() > EXTENSION.size() &&
+         aPath.compare(aPath.size() - EXTENSION.size(),
+                       EXTENSION.size(),
+                       EXTENSION) == 0;
+}
+
+bool
+text_output::TextOutputHelper::writeBallsFile(
+  const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+  char aSep)
+{
+  auto format = [&aBalls, aSep](
+    FormatBuffer& aBuffer, std::size_t aBegin, std::size_t aEnd) {
+    for (std::size_t i = aBegin; i < aEnd; ++i) {
+      const auto& ball = aBalls[i];
+      double radius_ceiled =
+        text_output::ceil(ball.mBallRadius, RADIUS_PRECISION);
+      aBuffer.append('\n');
+      aBuffer.appendFixed(ball.mPos.getLatDegree(), COORDINATE_PRECISION);
+      aBuffer.append(aSep);
+      aBuffer.appendFixed(ball.mPos.getLonDegree(), COORDINATE_PRECISION);
+      aBuffer.append(aSep);
+      aBuffer.appendUnsigned(i);
+      aBuffer.append(aSep);
+      aBuffer.appendFixed(radius_ceiled, RADIUS_PRECISION);
+    }
+  };
+
+  return text_output::writeChunked(
+    mOutputPath, aBalls.size(), mThreadCount, mCompress, format);
 }
 
 bool
@@ -70,35 +500,224 @@ text_output::TextOutputHelper::writeCompleteFile(
   char aSep,
   bool aExportHierarchy)
 {
-  std::ofstream file(mOutputPath.c_str());
+  auto format = [&aBalls, aSep, aExportHierarchy](
+    FormatBuffer& aBuffer, std::size_t aBegin, std::size_t aEnd) {
+    text_output::formatCompleteLines(
+      aBuffer, aBalls, aBegin, aEnd, 0, aSep, aExportHierarchy);
+  };
 
-  if (!file.is_open()) {
+  return text_output::writeChunked(
+    mOutputPath, aBalls.size(), mThreadCount, mCompress, format);
+}
+
+text_output::TextOutputHelper::~TextOutputHelper()
+{
+  if (mStreamFd >= 0) {
+    close(mStreamFd);
+  }
+}
+
+bool
+text_output::TextOutputHelper::beginCompleteFile(char aSep,
+                                                 bool aExportHierarchy)
+{
+  if (mStreamFd >= 0) {
+    throw std::runtime_error("The complete file " + mOutputPath +
+                             " is already being written!");
+  }
+  mStreamFd = open(mOutputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (mStreamFd < 0) {
     return false;
   }
-  file.clear();
+  // the count is patched at the end, reserve the size of its line
+  mStreamOffset = text_output::streamHeader(0, mCompress).size();
+  mStreamCount = 0;
+  mStreamSep = aSep;
+  mStreamHierarchy = aExportHierarchy;
+
+  return true;
+}
+
+bool
+text_output::TextOutputHelper::appendCompleteFile(
+  const std::vector<label_helper::LabelHelper::LabelBall>& aBatch)
+{
+  if (mStreamFd < 0) {
+    throw std::runtime_error("The complete file " + mOutputPath +
+                             " was not begun!");
+  }
+  std::size_t first = mStreamCount;
+  char sep = mStreamSep;
+  bool hierarchy = mStreamHierarchy;
+  auto format = [&aBatch, first, sep, hierarchy](
+    FormatBuffer& aBuffer, std::size_t aBegin, std::size_t aEnd) {
+    text_output::formatCompleteLines(
+      aBuffer, aBatch, aBegin, aEnd, first, sep, hierarchy);
+  };
+  mStreamCount += aBatch.size();
+
+  return text_output::writeChunks(mStreamFd,
+                                  mStreamOffset,
+                                  aBatch.size(),
+                                  mThreadCount,
+                                  mCompress,
+                                  format);
+}
 
-  std::size_t importance = 0;
-  file << aBalls.size();
+bool
+text_output::TextOutputHelper::finishCompleteFile()
+{
+  if (mStreamFd < 0) {
+    throw std::runtime_error("The complete file " + mOutputPath +
+                             " was not begun!");
+  }
+  FormatBuffer header = text_output::streamHeader(mStreamCount, mCompress);
+  bool success = header.writeAt(mStreamFd, 0);
 
-  for (auto ball : aBalls) {
+  success = close(mStreamFd) == 0 && success;
+  mStreamFd = -1;
+  return success;
+}
 
-    std::string label = ball.mLabel;
-    while (label.find("\n") != label.npos) {
-      label.replace(label.find('\n'), 1, "\\n");
+bool
+text_output::TextOutputHelper::writePermutationFile(
+  const std::vector<uint32_t>& aOrder)
+{
+  auto format = [&aOrder](
+    FormatBuffer& aBuffer, std::size_t aBegin, std::size_t aEnd) {
+    for (std::size_t i = aBegin; i < aEnd; ++i) {
+      aBuffer.append('\n');
+      aBuffer.appendUnsigned(aOrder[i]);
     }
-    double radius_ceiled =
-      text_output::ceil(ball.mBallRadius, RADIUS_PRECISION);
+  };
+
+  return text_output::writeChunked(
+    mOutputPath, aOrder.size(), mThreadCount, mCompress, format);
+}
+
+bool
+text_output::TextOutputHelper::writeBinaryFile(
+  const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+  bool aWithIndex)
+{
+  BinaryWriter file(mOutputPath, mCompress);
+  if (!file.isOpen()) {
+    return false;
+  }
 
-    std::size_t level = (aExportHierarchy) ? ball.mHierarchyLevel : importance;
+  std::size_t count = aBalls.size();
+  ball_file::Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.mMagic, ball_file::MAGIC, sizeof(header.mMagic));
+  header.mVersion = ball_file::VERSION;
+  header.mByteOrder = ball_file::BYTE_ORDER_MARK;
+  header.mCount = count;
+  for (const auto& ball : aBalls) {
+    header.mHeapSize += ball.mLabel.size();
+  }
 
-    file << "\n"
-         << std::fixed << std::setprecision(17) << ball.mPos.getLatDegree()
-         << aSep << ball.mPos.getLonDegree() << aSep << level << aSep
-         << std::fixed << std::setprecision(RADIUS_PRECISION) << radius_ceiled
-         << aSep << ball.mOsmId << aSep << "'" << label << "'" << aSep
-         << ball.mLabelFactor;
+  // every column is 64 byte aligned
+  uint64_t column = count * sizeof(double);
+  header.mLatOffset = sizeof(header);
+  header.mLonOffset = ball_file::alignOffset(header.mLatOffset + column);
+  header.mLevelOffset = ball_file::alignOffset(header.mLonOffset + column);
+  header.mRadiusOffset = ball_file::alignOffset(header.mLevelOffset + column);
+  header.mOsmIdOffset = ball_file::alignOffset(header.mRadiusOffset + column);
+  header.mLabelFactorOffset =
+    ball_file::alignOffset(header.mOsmIdOffset + column);
+  header.mLabelOffsetsOffset =
+    ball_file::alignOffset(header.mLabelFactorOffset + column);
+  header.mHeapOffset = ball_file::alignOffset(header.mLabelOffsetsOffset +
+                                              column + sizeof(uint64_t));
+  uint64_t end = header.mHeapOffset + header.mHeapSize;
 
-    ++importance;
+  std::unique_ptr<BallIndex> index;
+  if (aWithIndex && count > 0) {
+    index.reset(new BallIndex(aBalls, mThreadCount));
+    header.mIndexNodeSize = ball_file::INDEX_NODE_SIZE;
+    header.mIndexNodeCount = index->mRefs.size();
+    header.mIndexLevelCount = (uint32_t)index->mLevels.size();
+    header.mIndexBoxesOffset = ball_file::alignOffset(end);
+    header.mIndexRefsOffset = ball_file::alignOffset(
+      header.mIndexBoxesOffset + index->mBoxes.size() * sizeof(double));
+    header.mIndexLevelsOffset = ball_file::alignOffset(
+      header.mIndexRefsOffset + index->mRefs.size() * sizeof(uint64_t));
+  }
+
+  file.write(&header, sizeof(header));
+  file.writeColumn<double>(header.mLatOffset, count, [&aBalls](std::size_t i) {
+    return aBalls[i].mPos.getLatDegree();
+  });
+  file.writeColumn<double>(header.mLonOffset, count, [&aBalls](std::size_t i) {
+    return aBalls[i].mPos.getLonDegree();
+  });
+  file.writeColumn<uint64_t>(
+    header.mLevelOffset, count, [&aBalls](std::size_t i) {
+      return aBalls[i].mHierarchyLevel;
+    });
+  file.writeColumn<double>(
+    header.mRadiusOffset, count, [&aBalls](std::size_t i) {
+      return aBalls[i].mBallRadius;
+    });
+  file.writeColumn<int64_t>(
+    header.mOsmIdOffset, count, [&aBalls](std::size_t i) {
+      return aBalls[i].mOsmId;
+    });
+  file.writeColumn<double>(
+    header.mLabelFactorOffset, count, [&aBalls](std::size_t i) {
+      return aBalls[i].mLabelFactor;
+    });
+  uint64_t labelOffset = 0;
+  file.writeColumn<uint64_t>(
+    header.mLabelOffsetsOffset,
+    count + 1,
+    [&aBalls, &labelOffset](std::size_t i) {
+      uint64_t offset = labelOffset;
+      if (i < aBalls.size()) {
+        labelOffset += aBalls[i].mLabel.size();
+      }
+      return offset;
+    });
+  file.seek(header.mHeapOffset);
+  for (const auto& ball : aBalls) {
+    file.write(ball.mLabel.data(), ball.mLabel.size());
+  }
+
+  if (index) {
+    file.seek(header.mIndexBoxesOffset);
+    file.write(index->mBoxes.data(), index->mBoxes.size() * sizeof(double));
+    file.seek(header.mIndexRefsOffset);
+    file.write(index->mRefs.data(), index->mRefs.size() * sizeof(uint64_t));
+    file.seek(header.mIndexLevelsOffset);
+    file.write(index->mLevels.data(), index->mLevels.size() * sizeof(uint64_t));
+  }
+
+  return file.finish();
+}
+
+bool
+text_output::TextOutputHelper::writePoiFile(
+  const std::vector<osm_input::OsmPoi>& aPois)
+{
+  std::ofstream file(mOutputPath.c_str());
+
+  if (!file.is_open()) {
+    return false;
+  }
+  file.clear();
+
+  file << aPois.size();
+
+  for (const auto& poi : aPois) {
+    const auto& tags = poi.getTags();
+    file << "\n"
+         << poi.getOsmId() << '\t' << std::setprecision(17)
+         << poi.getPosition().getLatDegree() << '\t'
+         << poi.getPosition().getLonDegree() << '\t' << tags.size();
+    for (const auto& tag : tags) {
+      file << '\t' << text_output::escape(tag.mKey) << '\t'
+           << text_output::escape(tag.mValue);
+    }
   }
 
   file.close();
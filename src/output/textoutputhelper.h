@@ -31,12 +31,28 @@ namespace text_output {
 class TextOutputHelper
 {
 public:
-  TextOutputHelper(std::string aOutputPath)
-    : mOutputPath(aOutputPath){};
+  /**
+   * The ball files are formatted in chunks by aThreadCount threads, the
+   * chunks are written at their offsets in the file. If aOutputPath ends
+   * with ".gz" the ball and binary files are gzip compressed, every chunk
+   * becomes an independent gzip member compressed by its thread.
+   */
+  TextOutputHelper(std::string aOutputPath, int32_t aThreadCount = 1)
+    : mOutputPath(aOutputPath)
+    , mThreadCount(aThreadCount)
+    , mCompress(isGzipPath(aOutputPath))
+    , mStreamFd(-1)
+    , mStreamOffset(0)
+    , mStreamCount(0)
+    , mStreamSep(' ')
+    , mStreamHierarchy(false){};
+  ~TextOutputHelper();
   TextOutputHelper(const TextOutputHelper& other) = delete;
   TextOutputHelper& operator=(const TextOutputHelper& other) = delete;
   bool operator==(const TextOutputHelper& other) const = delete;
 
+  static bool isGzipPath(const std::string& aPath);
+
   bool writeBallsFile(
     const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
     char aSep);
@@ -46,8 +62,51 @@ public:
     char aSep,
     bool aExportHierarchy = false);
 
+  /**
+   * Write the complete file in batches, so the balls do not have to be kept
+   * in memory until all of them are computed. The count line is reserved
+   * with a fixed width (right aligned, padded with blanks) and patched by
+   * finishCompleteFile. The importance of a ball is its position in the
+   * stream.
+   */
+  bool beginCompleteFile(char aSep, bool aExportHierarchy = false);
+  bool appendCompleteFile(
+    const std::vector<label_helper::LabelHelper::LabelBall>& aBatch);
+  bool finishCompleteFile();
+
+  /**
+   * Write the count line followed by one line per element of aOrder, e.g.
+   * the importance ranks of the balls along a space filling curve (see
+   * poi_ordering::computeHilbertOrder).
+   */
+  bool writePermutationFile(const std::vector<uint32_t>& aOrder);
+
+  /**
+   * Write the balls in the memory mappable binary format of ball_file (see
+   * ballfile.h), optionally including the packed Hilbert R-tree.
+   */
+  bool writeBinaryFile(
+    const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+    bool aWithIndex = true);
+
+  /**
+   * Write the pois including their tags, so the set can be re-classified
+   * later without reading the pbf again (see poiset_input::PoiSetInput).
+   * The poi file is always written uncompressed.
+   */
+  bool writePoiFile(const std::vector<osm_input::OsmPoi>& aPois);
+
 private:
   std::string mOutputPath;
+  int32_t mThreadCount;
+  bool mCompress;
+
+  // state of the complete file stream, mStreamFd is -1 if none is open
+  int mStreamFd;
+  int64_t mStreamOffset;
+  std::size_t mStreamCount;
+  char mStreamSep;
+  bool mStreamHierarchy;
 };
 } // namespace text_output
 
@@ -0,0 +1,124 @@
+/*
+ * Typed numeric tag values parsed once per poi
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "numerictags.h"
+
+const int64_t osm_input::NumericTags::UNDEFINED;
+
+namespace {
+const int64_t MAX_VALUE = std::numeric_limits<int64_t>::max();
+
+bool
+isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+bool
+isSeparator(char c)
+{
+  return c == ',' || c == '.' || c == '\'' || c == ' ';
+}
+
+void
+appendDigit(int64_t& aValue, char aDigit)
+{
+  int64_t d = aDigit - '0';
+  if (aValue > (MAX_VALUE - d) / 10) {
+    aValue = MAX_VALUE;
+  } else {
+    aValue = aValue * 10 + d;
+  }
+}
+
+// true if aStr[aPos] is a separator followed by exactly three digits
+bool
+isThousandsGroup(const std::string& aStr, std::size_t aPos)
+{
+  if (aPos + 3 >= aStr.size()) {
+    return false;
+  }
+  if (!isSeparator(aStr[aPos])) {
+    return false;
+  }
+  for (std::size_t i = aPos + 1; i <= aPos + 3; ++i) {
+    if (!isDigit(aStr[i])) {
+      return false;
+    }
+  }
+
+  return aPos + 4 == aStr.size() || !isDigit(aStr[aPos + 4]);
+}
+} // namespace
+
+bool
+osm_input::NumericTags::parseValue(const std::string& aValue, int64_t& aResult)
+{
+  aResult = 0;
+
+  std::size_t pos = 0;
+  std::size_t size = aValue.size();
+  while (pos < size && aValue[pos] == ' ') {
+    ++pos;
+  }
+
+  // fast path: plain (optionally signed) integer
+  bool negative = false;
+  std::size_t start = pos;
+  if (pos < size && (aValue[pos] == '-' || aValue[pos] == '+')) {
+    negative = aValue[pos] == '-';
+    ++pos;
+  }
+  std::size_t digitsBegin = pos;
+  int64_t value = 0;
+  while (pos < size && isDigit(aValue[pos])) {
+    appendDigit(value, aValue[pos]);
+    ++pos;
+  }
+  if (pos > digitsBegin && pos == size) {
+    aResult = negative ? -value : value;
+    return true;
+  }
+
+  // fallback: first number in the string
+  pos = start;
+  while (pos < size && !isDigit(aValue[pos])) {
+    ++pos;
+  }
+  if (pos == size) {
+    return false;
+  }
+  negative = (pos == start + 1 && aValue[start] == '-');
+
+  value = 0;
+  while (pos < size) {
+    if (isDigit(aValue[pos])) {
+      appendDigit(value, aValue[pos]);
+      ++pos;
+    } else if (isThousandsGroup(aValue, pos)) {
+      ++pos;
+    } else {
+      break;
+    }
+  }
+
+  aResult = negative ? -value : value;
+  return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * Typed numeric tag values parsed once per poi
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef NUMERICTAGS_H
+#define NUMERICTAGS_H
+
+#include <limits>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace osm_input {
+
+/**
+ * Numeric values of the tags a mapping compares numerically (GREATER / LESS
+ * constraints and the ranking key). The slots are assigned by the
+ * MappingHelper, every poi stores one value per slot.
+ *
+ * A slot is UNDEFINED if the poi does not carry the tag. A tag that is present
+ * but can not be parsed at all is stored as 0, which is what std::atoi
+ * returned before.
+ */
+class NumericTags
+{
+public:
+  static const int64_t UNDEFINED = std::numeric_limits<int64_t>::min();
+
+  NumericTags() {}
+
+  NumericTags(std::size_t aSlotCount)
+    : mValues(aSlotCount, UNDEFINED){};
+
+  bool isDefined(std::size_t aSlot) const
+  {
+    return aSlot < mValues.size() && mValues[aSlot] != UNDEFINED;
+  };
+
+  int64_t get(std::size_t aSlot) const
+  {
+    return (aSlot < mValues.size()) ? mValues[aSlot] : UNDEFINED;
+  };
+
+  int64_t getOrDefault(std::size_t aSlot, int64_t aDefault) const
+  {
+    return isDefined(aSlot) ? mValues[aSlot] : aDefault;
+  };
+
+  void set(std::size_t aSlot, int64_t aValue) { mValues[aSlot] = aValue; };
+
+  std::size_t size() const { return mValues.size(); };
+
+  /**
+   * Parse an osm tag value into an integer.
+   *
+   * Plain integers ("5000", "-12", " 42") are parsed directly. Everything else
+   * is handled by a fallback that takes the first number occurring in the
+   * value:
+   *  - any prefix without digits is skipped ("ca. 5000", "~5000" -> 5000)
+   *  - ',', '.', '\'' and ' ' are treated as thousands separators if they are
+   *    followed by exactly three digits ("1,200" -> 1200, "1.200.000" ->
+   *    1200000, "3 000" -> 3000)
+   *  - otherwise the number ends at the first non digit character ("12.5" ->
+   *    12, "5000-6000" -> 5000, "5000 (2011)" -> 5000)
+   *  - a '-' directly in front of the first digit is only read as a sign if
+   *    nothing but whitespace precedes it
+   *
+   * Returns false if the value does not contain any digit. aResult is set to 0
+   * in that case.
+   */
+  static bool parseValue(const std::string& aValue, int64_t& aResult);
+
+private:
+  std::vector<int64_t> mValues;
+};
+} // namespace osm_input
+
+#endif // NUMERICTAGS_H
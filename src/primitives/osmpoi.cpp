@@ -21,19 +21,21 @@
 #include "osmpoi.h"
 
 #include <assert.h>
-#include <codecvt>
-#include <locale>
 #include <math.h>
 #include <unordered_map>
 
+#include "utf8helper.h"
+
 osm_input::OsmPoi::OsmPoi(int64_t aOsmId,
                           osm_input::OsmPoi::Position aPos,
                           const std::vector<osm_input::Tag>& aTags,
+                          const osm_input::NumericTags& aNumericTags,
                           const mapping_helper::MappingHelper::Level* aLevel)
   : mOsmId(aOsmId)
   , mPos(aPos)
   , mPoiLevel(aLevel)
-  , mTags(aTags){};
+  , mTags(aTags)
+  , mNumericTags(aNumericTags){};
 
 /*
 osm_input::OsmPoi::OsmPoi(int64_t aOsmId,
@@ -64,11 +66,8 @@ osm_input::OsmPoi::operator<(const osm_input::OsmPoi& aOther) const
   if (this->mPoiLevel != aOther.mPoiLevel) {
     return (*this->mPoiLevel < *aOther.mPoiLevel);
   } else {
-    std::string szPop = this->getTagValue("population");
-    std::string szOtherPop = aOther.getTagValue("population");
-    int32_t pop = (szPop != "<undefined>") ? std::atoi(szPop.c_str()) : 0;
-    int32_t otherPop =
-      (szOtherPop != "<undefined>") ? std::atoi(szOtherPop.c_str()) : 0;
+    int64_t pop = this->getRankingValue();
+    int64_t otherPop = aOther.getRankingValue();
     if (pop == otherPop)
       return mOsmId < aOther.mOsmId;
     else
@@ -95,14 +94,10 @@ osm_input::OsmPoi::operator>=(const osm_input::OsmPoi& aOther) const
 }
 
 namespace osmpoi {
-std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> CONVERT;
-
 std::size_t
 computeLengthUTF8(const std::string& aStr)
 {
-  std::u32string ws = CONVERT.from_bytes(aStr);
-
-  return ws.size();
+  return utf8_helper::UTF8Helper::computeLengthUTF8(aStr);
 };
 
 // compare https://en.wikipedia.org/wiki/Newline#Unicode
@@ -123,8 +118,7 @@ computeSplit(const std::string& aLabel,
              const std::unordered_set<char32_t>& aDelims)
 {
 
-  std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> convert;
-  std::u32string tmpLabel = convert.from_bytes(aLabel);
+  std::u32string tmpLabel = utf8_helper::UTF8Helper::toUTF8String(aLabel);
   std::u32string result = tmpLabel;
 
   bool newlineInfoPresent = false;
@@ -138,7 +132,7 @@ computeSplit(const std::string& aLabel,
   if (newlineInfoPresent) {
     std::unordered_set<char32_t> delim;
     delim.insert(U'%');
-    return computeSplit(convert.to_bytes(tmpLabel), delim);
+    return computeSplit(utf8_helper::UTF8Helper::toByteString(tmpLabel), delim);
   } else {
     std::size_t centerPos = (tmpLabel.size() + 1) / 2; // ceil division value
     std::size_t pos = 0;
@@ -175,7 +169,7 @@ computeSplit(const std::string& aLabel,
   if (result.find(U"% ") != result.npos)
     result = result.replace(result.find(U"% "), 2, U"%");
 
-  return convert.to_bytes(result);
+  return utf8_helper::UTF8Helper::toByteString(result);
 };
 
 double
@@ -243,6 +237,60 @@ osm_input::OsmPoi::getTagValue(std::string aTagName) const
   return "<undefined>";
 }
 
+const osm_input::NumericTags&
+osm_input::OsmPoi::getNumericTags() const
+{
+  return mNumericTags;
+}
+
+int64_t
+osm_input::OsmPoi::getRankingValue() const
+{
+  // pois without a ranking tag rank like a population of 0
+  return mNumericTags.getOrDefault(
+    mapping_helper::MappingHelper::RANKING_TAG_SLOT, 0);
+}
+
+namespace osmpoi {
+enum NameLvl
+{
+  undefined = 0,
+  name_en = 50,
+  int_name = 70,
+  official_name = 80,
+  name = 100,
+};
+} // namespace osmpoi
+
+std::string
+osm_input::OsmPoi::getImportName(const std::vector<osm_input::Tag>& aTags)
+{
+  using osmpoi::NameLvl;
+
+  std::string res = "";
+  NameLvl max_name_lvl = NameLvl::undefined;
+
+  for (const auto& t : aTags) {
+    if (t.mKey == "name:en" && max_name_lvl < NameLvl::name_en) {
+      res = t.mValue;
+      max_name_lvl = NameLvl::name_en;
+    } else if (t.mKey == "int_name" && max_name_lvl < NameLvl::int_name) {
+      res = t.mValue;
+      max_name_lvl = NameLvl::int_name;
+    } else if (t.mKey == "official_name" &&
+               max_name_lvl < NameLvl::official_name) {
+      res = t.mValue;
+      max_name_lvl = NameLvl::name;
+    } else if (t.mKey == "name" && max_name_lvl < NameLvl::name) {
+      res = t.mValue;
+      // highest valued name - skip when found this!
+      break;
+    }
+  }
+
+  return res;
+}
+
 std::string
 osm_input::OsmPoi::getName() const
 {
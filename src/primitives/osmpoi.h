@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "mappinghelper.h"
+#include "numerictags.h"
 #include "tag.h"
 
 namespace osm_input {
@@ -54,6 +55,7 @@ public:
   OsmPoi(int64_t aOsmId,
          osm_input::OsmPoi::Position aPos,
          const std::vector<osm_input::Tag>& aTags,
+         const osm_input::NumericTags& aNumericTags,
          const mapping_helper::MappingHelper::Level* aLvl);
 
   /*
@@ -79,7 +81,15 @@ public:
   const std::vector<osm_input::Tag>& getTags() const;
   std::string getTagValue(std::string aTagName) const;
 
+  const osm_input::NumericTags& getNumericTags() const;
+  int64_t getRankingValue() const;
+
   std::string getName() const;
+  /**
+   * The name the import requires for pois without an icon, empty if the tags
+   * have none
+   */
+  static std::string getImportName(const std::vector<osm_input::Tag>& aTags);
 
   bool hasIcon() const;
 
@@ -89,6 +99,7 @@ private:
   const mapping_helper::MappingHelper::Level* mPoiLevel;
 
   std::vector<Tag> mTags;
+  osm_input::NumericTags mNumericTags;
 };
 }
 
@@ -0,0 +1,685 @@
+/*
+ * Export of the label balls as a pyramid of Mapbox Vector Tiles
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "tileexporter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <json/json.h>
+#include <omp.h>
+#include <sqlite3.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "formatbuffer.h"
+#include "poiordering.h"
+#include "vector_tile.pb.h"
+
+const int32_t vector_tiles::TileExporter::MAX_ZOOM;
+const uint32_t vector_tiles::TileExporter::EXTENT;
+const uint32_t vector_tiles::TileExporter::TILE_SIZE_PX;
+
+namespace tileexporter {
+const std::string LAYER_NAME = "pois";
+// latitude of the border of the square web mercator world
+const double MAX_LATITUDE = 85.051128779806589;
+const double PI = 3.14159265358979323846;
+const double COORDINATE_SCALE = 4294967296.0;
+// the subtrees below this zoom are built in parallel
+const int32_t SPLIT_ZOOM = 6;
+const int32_t GZIP_LEVEL = 6;
+// the placement grid cells fit the discs of this share of the balls
+const double CELL_RADIUS_QUANTILE = 0.9;
+
+enum Key
+{
+  LABEL,
+  OSM_ID,
+  LEVEL,
+  IMPORTANCE,
+  RADIUS,
+  LABEL_FACTOR,
+  KEY_COUNT
+};
+const char* KEY_NAMES[KEY_COUNT] = { "label",      "osm_id", "level",
+                                     "importance", "radius", "label_factor" };
+const char* KEY_TYPES[KEY_COUNT] = { "String", "Number", "Number",
+                                     "Number", "Number", "Number" };
+
+// mercator coordinates in [0, 1], y grows to the south
+void
+project(const osm_input::OsmPoi::Position& aPos, double& aX, double& aY)
+{
+  double lat =
+    std::max(-MAX_LATITUDE, std::min(MAX_LATITUDE, aPos.getLatDegree()));
+  double sinLat = std::sin(lat * PI / 180);
+  aX = (aPos.getLonDegree() + 180) / 360;
+  aY = 0.5 - std::log((1 + sinLat) / (1 - sinLat)) / (4 * PI);
+}
+
+uint32_t
+toFixed(double aValue)
+{
+  double scaled = aValue * COORDINATE_SCALE;
+  return (scaled <= 0) ? 0 : (scaled >= COORDINATE_SCALE - 1)
+                               ? 0xFFFFFFFFu
+                               : (uint32_t)scaled;
+}
+
+// interleave the bits, y takes the higher bit of every pair
+uint64_t
+mortonKey(uint32_t aX, uint32_t aY)
+{
+  uint64_t key = 0;
+  for (int32_t bit = 31; bit >= 0; --bit) {
+    key = (key << 2) | (((aY >> bit) & 1) << 1) | ((aX >> bit) & 1);
+  }
+  return key;
+}
+
+/**
+ * End of the tile of zoom aZoom containing the ball aOrder[aBegin], the
+ * balls of a tile are consecutive in the Morton order
+ */
+std::size_t
+tileEnd(const std::vector<uint32_t>& aOrder,
+        const std::vector<uint32_t>& aX,
+        const std::vector<uint32_t>& aY,
+        std::size_t aBegin,
+        std::size_t aEnd,
+        int32_t aZoom)
+{
+  uint32_t shift = 32 - aZoom;
+  uint64_t tileX = uint64_t(aX[aOrder[aBegin]]) >> shift;
+  uint64_t tileY = uint64_t(aY[aOrder[aBegin]]) >> shift;
+  std::size_t end = aBegin + 1;
+  while (end < aEnd && uint64_t(aX[aOrder[end]]) >> shift == tileX &&
+         uint64_t(aY[aOrder[end]]) >> shift == tileY) {
+    ++end;
+  }
+  return end;
+}
+
+uint32_t
+zigZag(int32_t aValue)
+{
+  return ((uint32_t)aValue << 1) ^ (uint32_t)(aValue >> 31);
+}
+
+/**
+ * The values of a layer, every value is added once
+ */
+class ValueTable
+{
+public:
+  ValueTable(vector_tile::Tile_Layer* aLayer)
+    : mLayer(aLayer){};
+
+  uint32_t addString(const std::string& aValue)
+  {
+    auto it = mStrings.find(aValue);
+    if (it != mStrings.end()) {
+      return it->second;
+    }
+    uint32_t idx = mLayer->values_size();
+    mLayer->add_values()->set_string_value(aValue);
+    mStrings.emplace(aValue, idx);
+    return idx;
+  };
+
+  uint32_t addUnsigned(uint64_t aValue)
+  {
+    auto it = mUnsigned.find(aValue);
+    if (it != mUnsigned.end()) {
+      return it->second;
+    }
+    uint32_t idx = mLayer->values_size();
+    mLayer->add_values()->set_uint_value(aValue);
+    mUnsigned.emplace(aValue, idx);
+    return idx;
+  };
+
+  uint32_t addSigned(int64_t aValue)
+  {
+    auto it = mSigned.find(aValue);
+    if (it != mSigned.end()) {
+      return it->second;
+    }
+    uint32_t idx = mLayer->values_size();
+    mLayer->add_values()->set_sint_value(aValue);
+    mSigned.emplace(aValue, idx);
+    return idx;
+  };
+
+  uint32_t addDouble(double aValue)
+  {
+    uint64_t bits;
+    std::memcpy(&bits, &aValue, sizeof(bits));
+    auto it = mDoubles.find(bits);
+    if (it != mDoubles.end()) {
+      return it->second;
+    }
+    uint32_t idx = mLayer->values_size();
+    mLayer->add_values()->set_double_value(aValue);
+    mDoubles.emplace(bits, idx);
+    return idx;
+  };
+
+private:
+  vector_tile::Tile_Layer* mLayer;
+  std::unordered_map<std::string, uint32_t> mStrings;
+  std::unordered_map<uint64_t, uint32_t> mUnsigned;
+  std::unordered_map<int64_t, uint32_t> mSigned;
+  // keyed by the bit pattern
+  std::unordered_map<uint64_t, uint32_t> mDoubles;
+};
+
+/**
+ * Destination of the encoded tiles, put is called concurrently
+ */
+class TileSink
+{
+public:
+  virtual ~TileSink(){};
+
+  virtual bool put(int32_t aZoom,
+                   uint32_t aX,
+                   uint32_t aY,
+                   const std::string& aTile) = 0;
+  virtual bool finish(const Json::Value& aMetadata) = 0;
+};
+
+// creates a directory, existing ones are fine
+bool
+makeDirectory(const std::string& aPath)
+{
+  return mkdir(aPath.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+class DirectorySink : public TileSink
+{
+public:
+  DirectorySink(const std::string& aPath)
+    : mPath(aPath)
+  {
+    if (!makeDirectory(mPath)) {
+      throw std::runtime_error("Could not create the tile directory " +
+                               mPath + "!");
+    }
+  };
+
+  bool put(int32_t aZoom,
+           uint32_t aX,
+           uint32_t aY,
+           const std::string& aTile) override
+  {
+    std::string dir = mPath + "/" + std::to_string(aZoom);
+    if (!makeDirectory(dir)) {
+      return false;
+    }
+    dir += "/" + std::to_string(aX);
+    if (!makeDirectory(dir)) {
+      return false;
+    }
+    std::ofstream file(dir + "/" + std::to_string(aY) + ".pbf",
+                       std::ios::binary);
+    file.write(aTile.data(), aTile.size());
+    return (bool)file;
+  };
+
+  bool finish(const Json::Value& aMetadata) override
+  {
+    std::ofstream file(mPath + "/metadata.json");
+    Json::StyledWriter jsonWriter;
+    file << jsonWriter.write(aMetadata);
+    return (bool)file;
+  };
+
+private:
+  std::string mPath;
+};
+
+/**
+ * MBTiles 1.3 file, all tiles are inserted in one transaction
+ */
+class MBTilesSink : public TileSink
+{
+public:
+  MBTilesSink(const std::string& aPath)
+    : mDb(nullptr)
+    , mInsert(nullptr)
+  {
+    unlink(aPath.c_str());
+    if (sqlite3_open(aPath.c_str(), &mDb) != SQLITE_OK ||
+        !execute("PRAGMA synchronous = OFF;"
+                 "PRAGMA journal_mode = OFF;"
+                 "CREATE TABLE metadata (name TEXT, value TEXT);"
+                 "CREATE TABLE tiles (zoom_level INTEGER, tile_column "
+                 "INTEGER, tile_row INTEGER, tile_data BLOB);"
+                 "CREATE UNIQUE INDEX tile_index ON tiles "
+                 "(zoom_level, tile_column, tile_row);"
+                 "BEGIN;") ||
+        sqlite3_prepare_v2(mDb,
+                           "INSERT INTO tiles VALUES (?, ?, ?, ?);",
+                           -1,
+                           &mInsert,
+                           nullptr) != SQLITE_OK) {
+      std::string error = sqlite3_errmsg(mDb);
+      close();
+      throw std::runtime_error("Could not create the MBTiles file " + aPath +
+                               ": " + error);
+    }
+  };
+
+  ~MBTilesSink() { close(); };
+
+  bool put(int32_t aZoom,
+           uint32_t aX,
+           uint32_t aY,
+           const std::string& aTile) override
+  {
+    text_output::FormatBuffer compressed;
+    compressed.appendGzipMember(aTile.data(), aTile.size(), GZIP_LEVEL);
+    if (compressed.size() > (std::size_t)std::numeric_limits<int>::max()) {
+      return false;
+    }
+
+    // the rows are counted from the south (TMS)
+    uint32_t row = (uint32_t)((uint64_t(1) << aZoom) - 1 - aY);
+    std::lock_guard<std::mutex> lock(mLock);
+    bool success =
+      sqlite3_bind_int(mInsert, 1, aZoom) == SQLITE_OK &&
+      sqlite3_bind_int64(mInsert, 2, aX) == SQLITE_OK &&
+      sqlite3_bind_int64(mInsert, 3, row) == SQLITE_OK &&
+      sqlite3_bind_blob(mInsert,
+                        4,
+                        compressed.data(),
+                        (int)compressed.size(),
+                        SQLITE_STATIC) == SQLITE_OK &&
+      sqlite3_step(mInsert) == SQLITE_DONE;
+    sqlite3_reset(mInsert);
+    sqlite3_clear_bindings(mInsert);
+    return success;
+  };
+
+  bool finish(const Json::Value& aMetadata) override
+  {
+    sqlite3_stmt* insert = nullptr;
+    bool success = sqlite3_prepare_v2(mDb,
+                                      "INSERT INTO metadata VALUES (?, ?);",
+                                      -1,
+                                      &insert,
+                                      nullptr) == SQLITE_OK;
+    for (const auto& name : aMetadata.getMemberNames()) {
+      if (!success) {
+        break;
+      }
+      std::string value = aMetadata[name].asString();
+      success = sqlite3_bind_text(
+                  insert, 1, name.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK &&
+                sqlite3_bind_text(
+                  insert, 2, value.c_str(), -1, SQLITE_TRANSIENT) ==
+                  SQLITE_OK &&
+                sqlite3_step(insert) == SQLITE_DONE;
+      sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+
+    success = success && execute("COMMIT;");
+    return close() && success;
+  };
+
+private:
+  sqlite3* mDb;
+  sqlite3_stmt* mInsert;
+  std::mutex mLock;
+
+  bool execute(const char* aSql)
+  {
+    return sqlite3_exec(mDb, aSql, nullptr, nullptr, nullptr) == SQLITE_OK;
+  };
+
+  bool close()
+  {
+    sqlite3_finalize(mInsert);
+    mInsert = nullptr;
+    bool success = sqlite3_close(mDb) == SQLITE_OK;
+    mDb = nullptr;
+    return success;
+  };
+};
+
+/**
+ * Range of the Morton ordered balls covering the zooms [mFirstZoom,
+ * mLastZoom], the unit of work of the tile threads.
+ */
+struct TileTask
+{
+  int32_t mFirstZoom;
+  int32_t mLastZoom;
+  std::size_t mBegin;
+  std::size_t mEnd;
+};
+} // namespace tileexporter
+
+vector_tiles::TileExporter::TileExporter(int32_t aMinZoom,
+                                         int32_t aMaxZoom,
+                                         int32_t aThreadCount)
+  : mMinZoom(aMinZoom)
+  , mMaxZoom(aMaxZoom)
+  , mThreadCount(std::max(aThreadCount, 1))
+  , mTileCount(0)
+{
+  if (aMinZoom < 0 || aMinZoom > aMaxZoom || aMaxZoom > MAX_ZOOM) {
+    throw std::runtime_error("Invalid tile zoom range [" +
+                             std::to_string(aMinZoom) + ", " +
+                             std::to_string(aMaxZoom) + "], the zooms have "
+                                                        "to be in [0, " +
+                             std::to_string(MAX_ZOOM) + "]!");
+  }
+}
+
+bool
+vector_tiles::TileExporter::isMBTilesPath(const std::string& aPath)
+{
+  const std::string EXTENSION = ".mbtiles";
+  return aPath.size() > EXTENSION.size() &&
+         aPath.compare(aPath.size() - EXTENSION.size(),
+                       EXTENSION.size(),
+                       EXTENSION) == 0;
+}
+
+std::vector<std::vector<bool>>
+vector_tiles::TileExporter::placeBalls(
+  const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+  const std::vector<uint32_t>& aX,
+  const std::vector<uint32_t>& aY) const
+{
+  // the cells are sized for a typical disc, a few large labels would make
+  // them far too coarse
+  std::vector<double> radii;
+  radii.reserve(aBalls.size());
+  for (const auto& ball : aBalls) {
+    radii.push_back(ball.mBallRadius);
+  }
+  double cellRadius = 0;
+  if (!radii.empty()) {
+    auto quantile =
+      radii.begin() +
+      (std::size_t)(tileexporter::CELL_RADIUS_QUANTILE *
+                    (double)(radii.size() - 1));
+    std::nth_element(radii.begin(), quantile, radii.end());
+    cellRadius = *quantile;
+  }
+  double cellSize = std::max(2 * cellRadius, 1.0);
+
+  int32_t zoomCount = mMaxZoom - mMinZoom + 1;
+  std::vector<std::vector<bool>> placed(zoomCount);
+#pragma omp parallel for num_threads(mThreadCount) schedule(dynamic, 1)
+  for (int32_t z = 0; z < zoomCount; ++z) {
+    std::vector<bool>& zoomPlaced = placed[z];
+    zoomPlaced.assign(aBalls.size(), false);
+    double scale = std::ldexp((double)TILE_SIZE_PX, mMinZoom + z) /
+                   tileexporter::COORDINATE_SCALE;
+
+    // a placed disc is stored in every cell its bounding box covers, so two
+    // overlapping discs share at least one cell. The balls are sorted by
+    // ascending importance, so the most important one is placed first.
+    std::unordered_map<uint64_t, std::vector<uint32_t>> grid;
+    for (std::size_t i = aBalls.size(); i-- > 0;) {
+      double x = aX[i] * scale;
+      double y = aY[i] * scale;
+      double radius = aBalls[i].mBallRadius;
+      int64_t minCellX = (int64_t)std::floor((x - radius) / cellSize);
+      int64_t maxCellX = (int64_t)std::floor((x + radius) / cellSize);
+      int64_t minCellY = (int64_t)std::floor((y - radius) / cellSize);
+      int64_t maxCellY = (int64_t)std::floor((y + radius) / cellSize);
+
+      bool free = true;
+      for (int64_t cx = minCellX; cx <= maxCellX && free; ++cx) {
+        for (int64_t cy = minCellY; cy <= maxCellY && free; ++cy) {
+          auto cell = grid.find(((uint64_t)cx << 32) | (uint32_t)cy);
+          if (cell == grid.end()) {
+            continue;
+          }
+          for (uint32_t other : cell->second) {
+            double dx = aX[other] * scale - x;
+            double dy = aY[other] * scale - y;
+            double dist = radius + aBalls[other].mBallRadius;
+            if (dx * dx + dy * dy < dist * dist) {
+              free = false;
+              break;
+            }
+          }
+        }
+      }
+
+      if (free) {
+        zoomPlaced[i] = true;
+        for (int64_t cx = minCellX; cx <= maxCellX; ++cx) {
+          for (int64_t cy = minCellY; cy <= maxCellY; ++cy) {
+            grid[((uint64_t)cx << 32) | (uint32_t)cy].push_back((uint32_t)i);
+          }
+        }
+      }
+    }
+  }
+
+  return placed;
+}
+
+bool
+vector_tiles::TileExporter::write(
+  const std::string& aPath,
+  const std::string& aName,
+  const std::vector<label_helper::LabelHelper::LabelBall>& aBalls)
+{
+  std::unique_ptr<tileexporter::TileSink> sink;
+  if (isMBTilesPath(aPath)) {
+    sink.reset(new tileexporter::MBTilesSink(aPath));
+  } else {
+    sink.reset(new tileexporter::DirectorySink(aPath));
+  }
+
+  std::size_t count = aBalls.size();
+  std::vector<uint32_t> xs(count);
+  std::vector<uint32_t> ys(count);
+  poi_ordering::SortKeys keys(count, 1);
+#pragma omp parallel for num_threads(mThreadCount)
+  for (int64_t i = 0; i < (int64_t)count; ++i) {
+    double x, y;
+    tileexporter::project(aBalls[i].mPos, x, y);
+    xs[i] = tileexporter::toFixed(x);
+    ys[i] = tileexporter::toFixed(y);
+    keys.get(i)[0] = tileexporter::mortonKey(xs[i], ys[i]);
+  }
+
+  // every tile is a consecutive range of the Morton order, the sort also
+  // rejects more than 2^32 balls
+  std::vector<uint32_t> order = poi_ordering::radixSort(keys, mThreadCount);
+  keys = poi_ordering::SortKeys();
+
+  std::vector<std::vector<bool>> placed = placeBalls(aBalls, xs, ys);
+
+  // the zooms above the split zoom are built tile by tile, below they are
+  // built per subtree of a split zoom tile
+  int32_t splitZoom =
+    std::max(mMinZoom, std::min(mMaxZoom, tileexporter::SPLIT_ZOOM));
+  std::vector<tileexporter::TileTask> tasks;
+  for (int32_t z = mMinZoom; z <= splitZoom; ++z) {
+    std::size_t begin = 0;
+    while (begin < count) {
+      std::size_t end = tileexporter::tileEnd(order, xs, ys, begin, count, z);
+      if (z < splitZoom) {
+        tasks.push_back({ z, z, begin, end });
+      } else {
+        tasks.push_back({ z, mMaxZoom, begin, end });
+      }
+      begin = end;
+    }
+  }
+
+  bool success = true;
+  std::size_t tileCount = 0;
+  std::exception_ptr error;
+#pragma omp parallel for num_threads(mThreadCount) schedule(dynamic, 1) \
+  reduction(+ : tileCount)
+  for (int64_t t = 0; t < (int64_t)tasks.size(); ++t) {
+    const tileexporter::TileTask& task = tasks[t];
+    std::vector<uint32_t> rows;
+    try {
+      for (int32_t z = task.mFirstZoom; z <= task.mLastZoom; ++z) {
+        const std::vector<bool>& zoomPlaced = placed[z - mMinZoom];
+        uint32_t shift = 32 - z;
+        std::size_t begin = task.mBegin;
+        while (begin < task.mEnd) {
+          // shift >= 8, so the tile coordinates fit
+          uint32_t tileX = (uint32_t)(uint64_t(xs[order[begin]]) >> shift);
+          uint32_t tileY = (uint32_t)(uint64_t(ys[order[begin]]) >> shift);
+          std::size_t end =
+            tileexporter::tileEnd(order, xs, ys, begin, task.mEnd, z);
+          rows.clear();
+          for (std::size_t i = begin; i < end; ++i) {
+            if (zoomPlaced[order[i]]) {
+              rows.push_back(order[i]);
+            }
+          }
+          begin = end;
+          if (rows.empty()) {
+            continue;
+          }
+          // the most important balls (the largest rows) come first
+          std::sort(rows.begin(), rows.end(), std::greater<uint32_t>());
+
+          vector_tile::Tile tile;
+          vector_tile::Tile_Layer* layer = tile.add_layers();
+          layer->set_version(2);
+          layer->set_name(tileexporter::LAYER_NAME);
+          layer->set_extent(EXTENT);
+          for (int32_t k = 0; k < tileexporter::KEY_COUNT; ++k) {
+            layer->add_keys(tileexporter::KEY_NAMES[k]);
+          }
+          tileexporter::ValueTable values(layer);
+
+          uint64_t originX = uint64_t(tileX) << shift;
+          uint64_t originY = uint64_t(tileY) << shift;
+          for (uint32_t row : rows) {
+            const auto& ball = aBalls[row];
+            vector_tile::Tile_Feature* feature = layer->add_features();
+            feature->set_id(row);
+            feature->set_type(vector_tile::Tile_GeomType_POINT);
+            // a single MoveTo command
+            feature->add_geometry((1 << 3) | 1);
+            feature->add_geometry(tileexporter::zigZag(
+              (int32_t)(((xs[row] - originX) * EXTENT) >> shift)));
+            feature->add_geometry(tileexporter::zigZag(
+              (int32_t)(((ys[row] - originY) * EXTENT) >> shift)));
+
+            feature->add_tags(tileexporter::LABEL);
+            feature->add_tags(values.addString(ball.mLabel));
+            feature->add_tags(tileexporter::OSM_ID);
+            feature->add_tags(values.addSigned(ball.mOsmId));
+            feature->add_tags(tileexporter::LEVEL);
+            feature->add_tags(values.addUnsigned(ball.mHierarchyLevel));
+            feature->add_tags(tileexporter::IMPORTANCE);
+            feature->add_tags(values.addUnsigned(row));
+            feature->add_tags(tileexporter::RADIUS);
+            feature->add_tags(values.addDouble(ball.mBallRadius));
+            feature->add_tags(tileexporter::LABEL_FACTOR);
+            feature->add_tags(values.addDouble(ball.mLabelFactor));
+          }
+
+          std::string data;
+          tile.SerializeToString(&data);
+          if (!sink->put(z, tileX, tileY, data)) {
+#pragma omp critical
+            success = false;
+          }
+          ++tileCount;
+        }
+      }
+    } catch (...) {
+#pragma omp critical
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  mTileCount = tileCount;
+
+  double minLat = tileexporter::MAX_LATITUDE;
+  double minLon = 180;
+  double maxLat = -tileexporter::MAX_LATITUDE;
+  double maxLon = -180;
+  // the bounds of the tiled area, the latitude is limited by the projection
+  for (const auto& ball : aBalls) {
+    minLat = std::min(minLat, ball.mPos.getLatDegree());
+    minLon = std::min(minLon, ball.mPos.getLonDegree());
+    maxLat = std::max(maxLat, ball.mPos.getLatDegree());
+    maxLon = std::max(maxLon, ball.mPos.getLonDegree());
+  }
+  minLat = std::max(minLat, -tileexporter::MAX_LATITUDE);
+  maxLat = std::min(maxLat, tileexporter::MAX_LATITUDE);
+  if (aBalls.empty()) {
+    std::swap(minLat, maxLat);
+    std::swap(minLon, maxLon);
+  }
+
+  Json::Value layerInfo;
+  layerInfo["id"] = tileexporter::LAYER_NAME;
+  layerInfo["minzoom"] = mMinZoom;
+  layerInfo["maxzoom"] = mMaxZoom;
+  for (int32_t k = 0; k < tileexporter::KEY_COUNT; ++k) {
+    layerInfo["fields"][tileexporter::KEY_NAMES[k]] =
+      tileexporter::KEY_TYPES[k];
+  }
+  Json::Value layers;
+  layers["vector_layers"].append(layerInfo);
+  Json::FastWriter jsonWriter;
+  std::string layersJson = jsonWriter.write(layers);
+  layersJson.erase(layersJson.find_last_not_of('\n') + 1);
+
+  Json::Value metadata;
+  metadata["name"] = aName;
+  metadata["format"] = "pbf";
+  metadata["type"] = "overlay";
+  metadata["minzoom"] = std::to_string(mMinZoom);
+  metadata["maxzoom"] = std::to_string(mMaxZoom);
+  metadata["bounds"] = std::to_string(minLon) + "," + std::to_string(minLat) +
+                       "," + std::to_string(maxLon) + "," +
+                       std::to_string(maxLat);
+  metadata["json"] = layersJson;
+
+  return sink->finish(metadata) && success;
+}
@@ -0,0 +1,90 @@
+/*
+ * Export of the label balls as a pyramid of Mapbox Vector Tiles
+ *
+ * Copyright (C) 2016  Filip Krump <filip.krumpe@fmi.uni-stuttgart.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEEXPORTER_H
+#define TILEEXPORTER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "labelhelper.h"
+
+namespace vector_tiles {
+
+/**
+ * Writes the balls as one point layer "pois" into the vector tiles of the
+ * zoom levels [aMinZoom, aMaxZoom] (web mercator, tile extent 4096).
+ *
+ * The balls are expected in ascending importance order like the output of
+ * poi_ordering::sortPois, the last ball is the most important one. At every
+ * zoom the balls are placed greedily from the most important one down: a
+ * ball is dropped if its label disc, drawn with its radius in pixels of a
+ * 256 pixel tile, overlaps the disc of a more important ball placed before.
+ * The importance order is level first, so the least important levels vanish
+ * at the small zooms while the most important ones stay.
+ *
+ * The features carry the label, osm id, hierarchy level, importance, radius
+ * and label factor of their ball. Tiles without a placed ball are skipped.
+ */
+class TileExporter
+{
+public:
+  // the tile coordinates of the largest zoom still have 8 bits of precision
+  static const int32_t MAX_ZOOM = 24;
+  static const uint32_t EXTENT = 4096;
+  // tile size the ball radii are measured in
+  static const uint32_t TILE_SIZE_PX = 256;
+
+  TileExporter(int32_t aMinZoom, int32_t aMaxZoom, int32_t aThreadCount);
+
+  /**
+   * Write the tiles to aPath: an MBTiles file (gzip compressed tiles) if the
+   * path ends with ".mbtiles", a directory tree <z>/<x>/<y>.pbf with a
+   * metadata.json otherwise. Returns false if a tile could not be written.
+   */
+  bool write(const std::string& aPath,
+             const std::string& aName,
+             const std::vector<label_helper::LabelHelper::LabelBall>& aBalls);
+
+  // number of tiles written by the last call of write
+  std::size_t getTileCount() const { return mTileCount; };
+
+  static bool isMBTilesPath(const std::string& aPath);
+
+private:
+  int32_t mMinZoom;
+  int32_t mMaxZoom;
+  int32_t mThreadCount;
+
+  std::size_t mTileCount;
+
+  /**
+   * result[z - mMinZoom][i] is true if ball i is placed at zoom z. aX and aY
+   * are the mercator coordinates of the balls scaled to 2^32.
+   */
+  std::vector<std::vector<bool>> placeBalls(
+    const std::vector<label_helper::LabelHelper::LabelBall>& aBalls,
+    const std::vector<uint32_t>& aX,
+    const std::vector<uint32_t>& aY) const;
+};
+} // namespace vector_tiles
+
+#endif // TILEEXPORTER_H